@@ -19,7 +19,7 @@ for buggy_dir in "$PROJECT_ROOT"/*; do
         mkdir -p "$buggy_dir/build"
         cd "$buggy_dir/build"
 
-        cmake ..
+        cmake -DCMAKE_EXPORT_COMPILE_COMMANDS=ON ..
         make
         make coverage
 
@@ -0,0 +1,65 @@
+# turns the historical frequency json into constexpr tables
+#
+# usage: cmake -DINPUT=freq.json -DOUTPUT=builtin_frequencies.h
+#              -DTEMPLATE=builtin_frequencies.h.in -P generate_builtin_frequencies.cmake
+
+foreach(var INPUT OUTPUT TEMPLATE)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "generate_builtin_frequencies: ${var} is not set")
+    endif()
+endforeach()
+
+file(READ ${INPUT} json)
+get_filename_component(APR_FREQUENCY_JSON_NAME ${INPUT} NAME)
+
+# same order as FrequencyModel::Category. the "Operator" section holds placeholder values, not mined
+# from fix history, and stays out of the compiled-in tables until it is calibrated (--freq-json opts in)
+set(categories Replacement Insertion Deletion)
+
+set(symbols "")
+set(symbol_lines "")
+set(entry_lines "")
+set(APR_FREQUENCY_ENTRY_COUNT 0)
+
+# appends the name to the symbol list if new and sets <out> to its symbol
+macro(intern name out)
+    list(FIND symbols "${name}" _index)
+    if(_index EQUAL -1)
+        list(LENGTH symbols _index)
+        list(APPEND symbols "${name}")
+        string(APPEND symbol_lines "    \"${name}\",\n")
+    endif()
+    math(EXPR ${out} "${_index} + 1")
+endmacro()
+
+foreach(category IN LISTS categories)
+    string(JSON count ERROR_VARIABLE missing LENGTH "${json}" ${category})
+    if(missing)
+        continue() # e.g. no "Deletion" section
+    endif()
+    if(count EQUAL 0)
+        continue()
+    endif()
+    math(EXPR last "${count} - 1")
+    foreach(i RANGE ${last})
+        string(JSON target GET "${json}" ${category} ${i} target)
+        string(JSON freq GET "${json}" ${category} ${i} freq)
+        intern("${target}" target_symbol)
+        if(category STREQUAL "Replacement")
+            # replacement entries only have "target" and "freq"
+            set(source_symbol 0)
+        else()
+            string(JSON source GET "${json}" ${category} ${i} source)
+            intern("${source}" source_symbol)
+        endif()
+        string(APPEND entry_lines
+            "    {FrequencyModel::Category::${category}, ${target_symbol}, ${source_symbol}, ${freq}},\n")
+        math(EXPR APR_FREQUENCY_ENTRY_COUNT "${APR_FREQUENCY_ENTRY_COUNT} + 1")
+    endforeach()
+endforeach()
+
+# sizes are spelled out, a json without entries gives empty std::arrays instead of ill-formed T[] = {}
+list(LENGTH symbols APR_FREQUENCY_SYMBOL_COUNT)
+string(REGEX REPLACE "\n$" "" APR_FREQUENCY_SYMBOLS "${symbol_lines}")
+string(REGEX REPLACE "\n$" "" APR_FREQUENCY_ENTRIES "${entry_lines}")
+configure_file(${TEMPLATE} ${OUTPUT} @ONLY)
@@ -5,6 +5,8 @@
 #include <nlohmann/json.hpp>
 
 #include "../core/logger.h"
+#include "../core/trace.h"
+#include "../parser/include_graph.h"
 
 namespace apr_system {
 
@@ -17,11 +19,20 @@ CLIArgs CLIParser::parseArgs(int argc, char* argv[]) {
     args.commit_hash = "";
     args.sbfl_json = "";
     // args.sbfl_json = std::string(PROJECT_SOURCE_DIR) + "/src/testing_mock/data.json";
-    args.mutation_freq_json = std::string(PROJECT_SOURCE_DIR) + "/test-data/freq.json";
+    // empty selects the frequencies compiled in from test-data/freq.json
+    args.mutation_freq_json = "";
+    args.ranking_model = "";
+    args.knowledge_base = "";
     args.output_dir = "apr-project-results";
     args.buggy_program_dir = "";
-    args.max_patches = 5;
-    args.confidence_threshold = 0.7;
+    args.max_patches = std::nullopt;
+    args.confidence_threshold = 0.0;
+    args.ingredient_top_m = 0;
+    args.diversity = 1.0;
+    args.validation_workers = 1;
+    args.validation_workspace_dir = "";
+    args.trace_stages = "";
+    args.trace_file = "";
     args.config_file = "";
     args.build_script = "";
     args.test_script = "";
@@ -46,10 +57,30 @@ CLIArgs CLIParser::parseArgs(int argc, char* argv[]) {
             args.sbfl_json = argv[++i];
         } else if (arg == "--freq-json" && i + 1 < argc) {
             args.mutation_freq_json = argv[++i];
+        } else if (arg == "--ranking-model" && i + 1 < argc) {
+            args.ranking_model = argv[++i];
+        } else if (arg == "--knowledge-base" && i + 1 < argc) {
+            args.knowledge_base = argv[++i];
         } else if (arg == "--build" && i + 1 < argc) {
             args.build_script = argv[++i];
         } else if (arg == "--test" && i + 1 < argc) {
             args.test_script = argv[++i];
+        } else if (arg == "--max-patches" && i + 1 < argc) {
+            args.max_patches = std::stoi(argv[++i]);
+        } else if (arg == "--confidence-threshold" && i + 1 < argc) {
+            args.confidence_threshold = std::stod(argv[++i]);
+        } else if (arg == "--ingredient-top-m" && i + 1 < argc) {
+            args.ingredient_top_m = std::stoi(argv[++i]);
+        } else if (arg == "--diversity" && i + 1 < argc) {
+            args.diversity = std::stod(argv[++i]);
+        } else if (arg == "--validation-workers" && i + 1 < argc) {
+            args.validation_workers = std::stoi(argv[++i]);
+        } else if (arg == "--validation-workspace-dir" && i + 1 < argc) {
+            args.validation_workspace_dir = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            args.trace_stages = argv[++i];
+        } else if (arg == "--trace-file" && i + 1 < argc) {
+            args.trace_file = argv[++i];
         } else if (arg == "--use-testing-mock") {
             args.use_testing_mock = true;
         }
@@ -78,9 +109,35 @@ void CLIParser::printHelp() {
     std::cout << "  --output-dir DIR     directory to store results (default: apr-project-results)\n";
     std::cout << " --buggy-program DIR   directory to the buggy program\n";
     std::cout << "  --sbfl-json PATH     path to SBFL results json\n";
-    std::cout << "  --freq-json PATH     path to historical frequency json\n";
+    std::cout << "  --freq-json PATH     historical frequency json overriding the built-in one\n";
+    std::cout << "                       (the built-in one has no operator mutations, their frequencies\n";
+    std::cout << "                       are uncalibrated placeholders)\n";
+    std::cout << "  --ranking-model PATH patch-ranking model from apr_train_ranker (default: the\n";
+    std::cout << "                       similarity x suspiciousness x frequency product)\n";
+    std::cout << "  --knowledge-base PATH\n";
+    std::cout << "                       file of fixes from earlier runs, tried first and extended\n";
+    std::cout << "                       with this run's plausible patches (default: off)\n";
     std::cout << "  --build CMD          build command to compile project under test\n";
     std::cout << "  --test CMD           test command (ctest or gtest binary)\n";
+    std::cout << "  --max-patches N      number of candidates to generate, best first (default: 5000 with\n";
+    std::cout << "                       --ranking-model, 1000 with --diversity above 0, 200 otherwise;\n";
+    std::cout << "                       0 = all)\n";
+    std::cout << "  --confidence-threshold X\n";
+    std::cout << "                       skip candidates whose priority is below X (default: 0)\n";
+    std::cout << "  --ingredient-top-m N score only the N most context-similar ingredients per target\n";
+    std::cout << "                       and rule, via an LSH index (default: 0 = all)\n";
+    std::cout << "  --diversity X        interleave validation across locations and operator families,\n";
+    std::cout << "                       drawing from every generated candidate; 0 validates the top\n";
+    std::cout << "                       candidates in score order (default: 1)\n";
+    std::cout << "  --validation-workers N\n";
+    std::cout << "                       patches validated at once, each worker in a private clone of\n";
+    std::cout << "                       the repository (default: 1 = in place, 0 = one per core)\n";
+    std::cout << "  --validation-workspace-dir DIR\n";
+    std::cout << "                       where workers clone the repository, on its filesystem so files\n";
+    std::cout << "                       are reflinked (default: a hidden directory next to it)\n";
+    std::cout << "  --trace STAGES       write an NDJSON trace of the given stages (comma-separated:\n";
+    std::cout << "                       parser, mutator, prioritizer, validator, all; default: off)\n";
+    std::cout << "  --trace-file PATH    trace output (default: <output-dir>/trace.ndjson)\n";
     std::cout << "  --use-testing-mock   convenience flag to target src/testing_mock\n";
     std::cout << "  --verbose, -v        enable verbose output\n";
     std::cout << "  --help, -h           show this help message\n\n";
@@ -90,6 +147,13 @@ void CLIParser::printHelp() {
 
 bool CLIParser::validateArgs(const CLIArgs& args) {
     // simplified validation
+    if (args.max_patches.value_or(0) < 0 || args.confidence_threshold < 0.0 || args.ingredient_top_m < 0 ||
+        args.diversity < 0.0 || args.validation_workers < 0) {
+        return false;
+    }
+    if (!Trace::parseStages(args.trace_stages)) {
+        return false;
+    }
     return true;
 }
 
@@ -172,16 +236,13 @@ CoverageData CLIParser::loadCoverageData(const std::string& file_path) {
 }
 
 std::vector<std::string> CLIParser::findSourceFiles(const std::string& buggy_program_dir) {
-    // simplified -> return static list
-    const std::string buggy_program_src = buggy_program_dir + "/src";
-    std::vector<std::string> files;
-    for (const auto& entry : std::filesystem::directory_iterator(buggy_program_src)) {
-        if (entry.is_regular_file() && entry.path().extension() == ".cpp") {
-            files.push_back(entry.path().string());
-        }
+    if (buggy_program_dir.empty()) {
+        return {};
     }
 
-    return files;
+    // compile_commands.json (or a src/ + include/ scan) plus the include graph,
+    // each shared header is listed once so the parser parses it once
+    return IncludeGraph::discover(buggy_program_dir).sourceFiles();
 }
 
 CoverageData CLIParser::createMockCoverageData() {
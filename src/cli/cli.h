@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../core/types.h"
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -15,13 +16,23 @@ struct CLIArgs {
   std::string commit_hash;
   std::string sbfl_json;
   std::string mutation_freq_json;
+  std::string ranking_model;
+  std::string knowledge_base;
   std::string buggy_program_dir;
   std::string output_dir;
   std::string config_file;
   std::string build_script;
   std::string test_script;
-  int max_patches;
+  // unset: sized from the validation budget, see Orchestrator::kRerankedCandidatePool
+  std::optional<int> max_patches;
   double confidence_threshold;
+  int ingredient_top_m;
+  double diversity;
+  int validation_workers;
+  // empty: next to the repository, see ValidationConfig::workspace_dir
+  std::string validation_workspace_dir;
+  std::string trace_stages;
+  std::string trace_file;
   bool help;
   bool verbose;
   bool use_testing_mock;
@@ -78,8 +89,11 @@ public:
 
 private:
   /**
-   * @brief find source files in buggy program directories
-   * @return vector of source file paths
+   * @brief find source and header files of the buggy program
+   *
+   * driven by compile_commands.json when available, see IncludeGraph.
+   *
+   * @return vector of source file paths, each listed once
    */
   static std::vector<std::string> findSourceFiles(const std::string &buggy_program_dir);
 
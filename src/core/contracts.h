@@ -2,6 +2,7 @@
 
 #include "types.h"
 #include <memory>
+#include <optional>
 #include <vector>
 
 namespace apr_system {
@@ -67,6 +68,31 @@ public:
                   const std::vector<std::string> &source_files) = 0;
 };
 
+/**
+ * @brief order in which the validator pulls candidates, may adapt to the
+ * outcomes reported back while validation runs
+ */
+class IValidationQueue {
+public:
+  virtual ~IValidationQueue() = default;
+
+  /**
+   * @brief number of candidates the queue hands out in total
+   */
+  virtual size_t size() const = 0;
+
+  /**
+   * @brief the candidate to validate next
+   * @return index into the patch candidates, nullopt once all were handed out
+   */
+  virtual std::optional<size_t> next() = 0;
+
+  /**
+   * @brief report the outcome of a candidate returned by next()
+   */
+  virtual void record(size_t candidate, const ValidationResult &result) = 0;
+};
+
 /**
  * @brief interface for patch prioritizer component
  */
@@ -77,12 +103,24 @@ public:
   /**
    * @brief prioritize patch candidates based on various heuristics
    * @param patch_candidates list of patch candidates
-   * @param test_results test execution results for feature extraction
-   * @return vector of prioritized patches sorted by priority score
+   * @param mutation_freq_json mutation frequencies
+   * @param top_k length of the ranking, 0 ranks every scoring candidate
+   * @return the top_k candidates with a positive score, best first, as
+   * indices into patch_candidates
    */
-  virtual std::vector<PatchCandidate>
+  virtual std::vector<RankedPatch>
   prioritizePatches(const std::vector<PatchCandidate> &patch_candidates,
-                    const std::string &mutation_freq_json) = 0;
+                    const std::string &mutation_freq_json, size_t top_k = 0) = 0;
+
+  /**
+   * @brief queue that feeds a ranking to the validator
+   * @param patch_candidates candidates the ranking refers to
+   * @param prioritized_patches ranking from prioritizePatches
+   * @return queue starting in ranking order
+   */
+  virtual std::unique_ptr<IValidationQueue>
+  validationQueue(const std::vector<PatchCandidate> &patch_candidates,
+                  const std::vector<RankedPatch> &prioritized_patches) = 0;
 };
 
 /**
@@ -94,13 +132,15 @@ public:
 
   /**
    * @brief validate patch candidates by applying them and running tests
-   * @param prioritized_patches list of prioritized patches to validate
+   * @param patch_candidates candidates the queue refers to
+   * @param queue validation order, told every outcome
    * @param repo_metadata repository metadata for build/test configuration
    * @param top_k number of top patches to validate
    * @return vector of validation results
    */
   virtual std::vector<ValidationResult>
-  validatePatches(const std::vector<PatchCandidate> &prioritized_patches,
+  validatePatches(const std::vector<PatchCandidate> &patch_candidates,
+                  IValidationQueue &queue,
                   const RepositoryMetadata &repo_metadata, int top_k = 100) = 0;
 };
 
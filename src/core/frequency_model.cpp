@@ -0,0 +1,147 @@
+#include "frequency_model.h"
+#include "builtin_frequencies.h"
+
+#include <bit>
+#include <fstream>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+
+namespace apr_system {
+
+namespace {
+
+constexpr std::array<const char *, FrequencyModel::kCategories> kCategoryNames = {
+    "Replacement", "Insertion", "Deletion", "Operator"};
+
+// splitmix64 finalizer, spreads the packed fields over the table
+uint64_t mix64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+} // namespace
+
+std::optional<FrequencyModel::Category> FrequencyModel::categoryOf(std::string_view name) {
+    for (size_t i = 0; i < kCategories; ++i) {
+        if (name == kCategoryNames[i]) return static_cast<Category>(i);
+    }
+    return std::nullopt;
+}
+
+std::shared_ptr<const FrequencyModel> FrequencyModel::load(const std::string &path) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        throw std::runtime_error("failed to open frequency file: " + path);
+    }
+    nlohmann::json data;
+    try {
+        data = nlohmann::json::parse(in);
+    } catch (const nlohmann::json::exception &e) {
+        throw std::runtime_error("failed to parse frequency file " + path + ": " + e.what());
+    }
+
+    std::array<std::vector<FreqEntry>, kCategories> entries;
+    for (size_t i = 0; i < kCategories; ++i) {
+        if (!data.contains(kCategoryNames[i])) continue;
+        for (const auto &item : data[kCategoryNames[i]]) {
+            FreqEntry e;
+            e.target_node = item.at("target").get<std::string>();
+            // replacement entries only have "target" and "freq"
+            e.source_node = item.value("source", "");
+            e.freq = item.at("freq").get<double>();
+            entries[i].push_back(std::move(e));
+        }
+    }
+    return fromEntries(std::move(entries), path);
+}
+
+std::shared_ptr<const FrequencyModel> FrequencyModel::builtin() {
+    static const std::shared_ptr<const FrequencyModel> model = [] {
+        std::shared_ptr<FrequencyModel> m(new FrequencyModel());
+        // seed the symbols in generated order so build() keeps the build-time ids
+        for (std::string_view name : builtin_frequencies::kSymbols) m->intern(std::string(name));
+        for (const auto &e : builtin_frequencies::kEntries) {
+            FreqEntry entry;
+            entry.target_node = builtin_frequencies::kSymbols[e.target - 1];
+            if (e.source != kUnknown) entry.source_node = builtin_frequencies::kSymbols[e.source - 1];
+            entry.freq = e.freq;
+            m->entries_[static_cast<size_t>(e.category)].push_back(std::move(entry));
+        }
+        m->build();
+        return m;
+    }();
+    return model;
+}
+
+std::shared_ptr<const FrequencyModel>
+FrequencyModel::fromEntries(std::array<std::vector<FreqEntry>, kCategories> entries, std::string source_path) {
+    std::shared_ptr<FrequencyModel> model(new FrequencyModel());
+    model->entries_ = std::move(entries);
+    model->source_path_ = std::move(source_path);
+    model->build();
+    return model;
+}
+
+uint32_t FrequencyModel::intern(const std::string &name) {
+    auto [it, inserted] = symbols_.try_emplace(name, static_cast<uint32_t>(symbols_.size() + 1));
+    return it->second;
+}
+
+uint64_t FrequencyModel::pack(Category category, uint32_t target, uint32_t source) {
+    // category + 1 keeps every key non-zero; symbols stay far below 2^28
+    return (static_cast<uint64_t>(category) + 1) << 56 | static_cast<uint64_t>(target) << 28 | source;
+}
+
+void FrequencyModel::build() {
+    size_t total = 0;
+    for (const auto &list : entries_) total += list.size();
+    // at most half full, so probe sequences stay short
+    table_.assign(std::bit_ceil(std::max<size_t>(8, 2 * total)), Slot{});
+    mask_ = table_.size() - 1;
+
+    for (size_t c = 0; c < kCategories; ++c) {
+        const auto category = static_cast<Category>(c);
+        for (const auto &e : entries_[c]) {
+            const uint32_t target = intern(e.target_node);
+            const uint32_t source = category == Category::Replacement ? kUnknown : intern(e.source_node);
+            const uint64_t key = pack(category, target, source);
+            for (uint64_t i = mix64(key) & mask_;; i = (i + 1) & mask_) {
+                if (table_[i].key == 0 || table_[i].key == key) {
+                    table_[i] = {key, e.freq}; // later entries win
+                    break;
+                }
+            }
+        }
+    }
+}
+
+uint32_t FrequencyModel::symbol(std::string_view name) const {
+    auto it = symbols_.find(name);
+    return it == symbols_.end() ? kUnknown : it->second;
+}
+
+const FrequencyModel::Slot *FrequencyModel::probe(uint64_t key) const {
+    for (uint64_t i = mix64(key) & mask_;; i = (i + 1) & mask_) {
+        if (table_[i].key == key) return &table_[i];
+        if (table_[i].key == 0) return nullptr;
+    }
+}
+
+double FrequencyModel::lookup(Category category, uint32_t target, uint32_t source) const {
+    if (target == kUnknown) return 0.0;
+    if (category == Category::Replacement) source = kUnknown;
+    const Slot *slot = probe(pack(category, target, source));
+    return slot ? slot->freq : 0.0;
+}
+
+double FrequencyModel::lookup(const MutationType &type) const {
+    const auto category = categoryOf(type.mutation_category);
+    if (!category) return 0.0;
+    const uint32_t source = *category == Category::Replacement ? kUnknown : symbol(type.source_node);
+    if (*category != Category::Replacement && source == kUnknown) return 0.0;
+    return lookup(*category, symbol(type.target_node), source);
+}
+
+} // namespace apr_system
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "types.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace apr_system {
+
+/**
+ * @brief immutable historical mutation frequencies
+ *
+ * loaded once from the frequency json and shared by the mutator (rule
+ * table) and the prioritizer (scoring). node type names are interned to
+ * integer symbols and every (category, target, source) triple is packed
+ * into one 64-bit key of a flat open-addressing table, so a lookup is a
+ * hash of the key and, at the table's low load, usually a single probe.
+ *
+ * duplicate entries keep the last frequency, like the prioritizer always
+ * did. replacement entries only name the target and match any source.
+ *
+ * the build compiles test-data/freq.json (APR_FREQUENCY_JSON) into the
+ * constexpr tables of the generated builtin_frequencies.h; builtin() serves
+ * them without touching the json, load() remains the --freq-json override.
+ */
+class FrequencyModel {
+public:
+  enum class Category : uint8_t { Replacement, Insertion, Deletion, Operator };
+  static constexpr size_t kCategories = 4;
+  // symbol of names the model has never seen
+  static constexpr uint32_t kUnknown = 0;
+
+  /**
+   * @brief load the frequency json
+   * @param path file with "Replacement", "Insertion", "Deletion" and an
+   * optional "Operator" section
+   * @return the shared model
+   * @throws std::runtime_error if the file cannot be read or parsed
+   */
+  static std::shared_ptr<const FrequencyModel> load(const std::string &path);
+
+  /**
+   * @brief the model compiled in at build time, built on first use
+   * @return the shared model, its sourcePath() is empty
+   */
+  static std::shared_ptr<const FrequencyModel> builtin();
+
+  /**
+   * @brief build a model from entries, e.g. for tests
+   */
+  static std::shared_ptr<const FrequencyModel>
+  fromEntries(std::array<std::vector<FreqEntry>, kCategories> entries,
+              std::string source_path = "");
+
+  static std::optional<Category> categoryOf(std::string_view name);
+
+  /**
+   * @brief interned symbol of a node type (or operator class) name
+   * @return kUnknown if no entry mentions it
+   */
+  uint32_t symbol(std::string_view name) const;
+
+  /**
+   * @brief frequency of a mutation, 0.0 if there is no entry
+   */
+  double lookup(Category category, uint32_t target, uint32_t source) const;
+
+  /**
+   * @brief frequency of a candidate's mutation type, 0.0 if unknown
+   */
+  double lookup(const MutationType &type) const;
+
+  /**
+   * @brief entries of a category in file order, duplicates included
+   */
+  const std::vector<FreqEntry> &entries(Category category) const {
+    return entries_[static_cast<size_t>(category)];
+  }
+
+  /**
+   * @brief the file the model was loaded from, empty if built in memory
+   * or compiled in
+   */
+  const std::string &sourcePath() const { return source_path_; }
+
+private:
+  struct Slot {
+    uint64_t key = 0; // 0 marks an empty slot, real keys are never 0
+    double freq = 0.0;
+  };
+
+  struct NameHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+  };
+
+  FrequencyModel() = default;
+  void build();
+  uint32_t intern(const std::string &name);
+  static uint64_t pack(Category category, uint32_t target, uint32_t source);
+  const Slot *probe(uint64_t key) const;
+
+  std::array<std::vector<FreqEntry>, kCategories> entries_;
+  std::unordered_map<std::string, uint32_t, NameHash, std::equal_to<>> symbols_;
+  std::vector<Slot> table_;
+  uint64_t mask_ = 0;
+  std::string source_path_;
+};
+
+} // namespace apr_system
@@ -0,0 +1,273 @@
+#include "knowledge_base.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace apr_system {
+
+namespace {
+
+constexpr char kMagic[8] = {'A', 'P', 'R', 'K', 'B', '\0', '\0', '1'};
+constexpr uint64_t kInitialCapacity = 1024;
+
+// FNV-1a, stable across builds unlike std::hash
+uint64_t fnv1a(std::string_view text, uint64_t h = 0xcbf29ce484222325ull) {
+    for (unsigned char c : text) {
+        h ^= c;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+// splitmix64 finalizer
+uint64_t mix64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+std::runtime_error file_error(const std::string &what, const std::string &path) {
+    return std::runtime_error(what + " knowledge base " + path + ": " + std::strerror(errno));
+}
+
+// Helper, whether fd still refers to the file path names
+bool sameFile(int fd, const std::string &path) {
+    struct stat held{}, named{};
+    return ::fstat(fd, &held) == 0 && ::stat(path.c_str(), &named) == 0 && held.st_dev == named.st_dev &&
+           held.st_ino == named.st_ino;
+}
+
+// Helper, opens path with an exclusive lock on the file it names, retrying
+// when another process swaps in a grown file while we wait for the lock
+int openLocked(const std::string &path) {
+    for (;;) {
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) throw file_error("failed to open", path);
+        if (::flock(fd, LOCK_EX) != 0) {
+            const int error = errno;
+            ::close(fd);
+            errno = error;
+            throw file_error("failed to lock", path);
+        }
+        if (sameFile(fd, path)) return fd;
+        ::close(fd);
+    }
+}
+
+} // namespace
+
+struct KnowledgeBase::Header {
+    char magic[8];
+    uint64_t capacity; // slots, a power of two
+    uint64_t count;    // occupied slots
+};
+
+struct KnowledgeBase::Slot {
+    uint64_t key; // 0 marks an empty slot
+    uint32_t successes;
+    uint32_t reserved;
+};
+
+std::unique_ptr<KnowledgeBase> KnowledgeBase::open(const std::string &path) {
+    std::unique_ptr<KnowledgeBase> kb(new KnowledgeBase(path));
+    // the knowledge base owns the descriptor from here on, so every throw
+    // below closes it and drops the lock
+    kb->fd_ = openLocked(path);
+
+    struct stat st{};
+    if (::fstat(kb->fd_, &st) != 0) throw file_error("failed to stat", path);
+    if (st.st_size == 0) {
+        const size_t bytes = sizeof(Header) + kInitialCapacity * sizeof(Slot);
+        if (::ftruncate(kb->fd_, static_cast<off_t>(bytes)) != 0) throw file_error("failed to size", path);
+        kb->map(bytes);
+        Header &h = kb->header();
+        std::memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.capacity = kInitialCapacity;
+        h.count = 0;
+    } else {
+        kb->map(static_cast<size_t>(st.st_size));
+    }
+    kb->validate();
+    kb->unlock();
+    return kb;
+}
+
+KnowledgeBase::~KnowledgeBase() {
+    unmap();
+    if (fd_ >= 0) ::close(fd_);
+}
+
+void KnowledgeBase::map(size_t bytes) {
+    if (bytes < sizeof(Header)) throw std::runtime_error("not a knowledge base: " + path_);
+    void *data = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (data == MAP_FAILED) throw file_error("failed to map", path_);
+    data_ = data;
+    bytes_ = bytes;
+}
+
+void KnowledgeBase::validate() {
+    const Header &h = header();
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 || h.capacity == 0 ||
+        (h.capacity & (h.capacity - 1)) != 0 || bytes_ != sizeof(Header) + h.capacity * sizeof(Slot)) {
+        unmap();
+        throw std::runtime_error("not a knowledge base: " + path_);
+    }
+}
+
+void KnowledgeBase::unmap() {
+    if (!data_) return;
+    ::msync(data_, bytes_, MS_SYNC);
+    ::munmap(data_, bytes_);
+    data_ = nullptr;
+    bytes_ = 0;
+}
+
+void KnowledgeBase::lock() {
+    if (::flock(fd_, LOCK_EX) != 0) throw file_error("failed to lock", path_);
+    if (!sameFile(fd_, path_)) {
+        // another process grew the file and swapped it in since we mapped it
+        ::flock(fd_, LOCK_UN);
+        const int fd = openLocked(path_);
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            const int error = errno;
+            ::close(fd);
+            errno = error;
+            throw file_error("failed to stat", path_);
+        }
+        unmap();
+        ::close(fd_);
+        fd_ = fd;
+        map(static_cast<size_t>(st.st_size));
+        validate();
+    }
+}
+
+void KnowledgeBase::unlock() {
+    ::flock(fd_, LOCK_UN);
+}
+
+KnowledgeBase::Header &KnowledgeBase::header() const {
+    return *static_cast<Header *>(data_);
+}
+
+KnowledgeBase::Slot *KnowledgeBase::slots() const {
+    return reinterpret_cast<Slot *>(static_cast<char *>(data_) + sizeof(Header));
+}
+
+uint64_t KnowledgeBase::genealogyHash(const GenealogyContext &genealogy) {
+    // a sum of per-entry hashes does not depend on the map's iteration order
+    uint64_t h = 0;
+    for (const auto &[type, count] : genealogy.type_counts) {
+        h += mix64(fnv1a(type) ^ static_cast<uint64_t>(count));
+    }
+    return h;
+}
+
+uint64_t KnowledgeBase::key(std::string_view node_type, uint64_t genealogy_hash,
+                            std::string_view mutation_category, std::string_view source_node) {
+    uint64_t h = fnv1a(node_type);
+    h = fnv1a(std::string_view("\0", 1), h);
+    h = fnv1a(mutation_category, h);
+    h = fnv1a(std::string_view("\0", 1), h);
+    h = fnv1a(source_node, h);
+    const uint64_t k = mix64(h ^ mix64(genealogy_hash));
+    return k == 0 ? 1 : k;
+}
+
+uint64_t KnowledgeBase::key(const PatchCandidate &patch) {
+    const MutationType &type = patch.mutation_type;
+    return key(type.target_node, patch.genealogy_hash, type.mutation_category, type.source_node);
+}
+
+uint32_t KnowledgeBase::successes(uint64_t key) const {
+    const uint64_t mask = header().capacity - 1;
+    const Slot *table = slots();
+    for (uint64_t i = mix64(key) & mask;; i = (i + 1) & mask) {
+        if (table[i].key == key) return table[i].successes;
+        if (table[i].key == 0) return 0;
+    }
+}
+
+void KnowledgeBase::recordSuccess(uint64_t key) {
+    lock();
+    struct Unlock {
+        KnowledgeBase *kb;
+        ~Unlock() { kb->unlock(); }
+    } unlock{this};
+
+    if ((header().count + 1) * 2 > header().capacity) grow();
+    const uint64_t mask = header().capacity - 1;
+    Slot *table = slots();
+    for (uint64_t i = mix64(key) & mask;; i = (i + 1) & mask) {
+        if (table[i].key == key) {
+            ++table[i].successes;
+            return;
+        }
+        if (table[i].key == 0) {
+            table[i] = {key, 1, 0};
+            ++header().count;
+            return;
+        }
+    }
+}
+
+size_t KnowledgeBase::size() const {
+    return header().count;
+}
+
+void KnowledgeBase::grow() {
+    // rehash into a file twice the size next to the old one, then swap it in.
+    // the caller holds the lock, so no other process grows concurrently
+    const uint64_t capacity = header().capacity * 2;
+    const size_t bytes = sizeof(Header) + capacity * sizeof(Slot);
+    const std::string tmp = path_ + ".tmp";
+    const int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) throw file_error("failed to grow", path_);
+    void *data = MAP_FAILED;
+    auto fail = [&] {
+        const int error = errno;
+        if (data != MAP_FAILED) ::munmap(data, bytes);
+        ::close(fd);
+        ::unlink(tmp.c_str());
+        errno = error;
+        return file_error("failed to grow", path_);
+    };
+    // lock the new file before anyone can open it under path_
+    if (::flock(fd, LOCK_EX) != 0 || ::ftruncate(fd, static_cast<off_t>(bytes)) != 0) throw fail();
+    data = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) throw fail();
+
+    auto *h = static_cast<Header *>(data);
+    auto *table = reinterpret_cast<Slot *>(static_cast<char *>(data) + sizeof(Header));
+    std::memcpy(h->magic, kMagic, sizeof(kMagic));
+    h->capacity = capacity;
+    h->count = header().count;
+    const Slot *old = slots();
+    for (uint64_t s = 0; s < header().capacity; ++s) {
+        if (old[s].key == 0) continue;
+        for (uint64_t i = mix64(old[s].key) & (capacity - 1);; i = (i + 1) & (capacity - 1)) {
+            if (table[i].key == 0) {
+                table[i] = old[s];
+                break;
+            }
+        }
+    }
+    if (::msync(data, bytes, MS_SYNC) != 0 || ::rename(tmp.c_str(), path_.c_str()) != 0) throw fail();
+
+    // closing the old file wakes processes waiting for its lock, they find
+    // it replaced and reopen path_
+    unmap();
+    ::close(fd_);
+    fd_ = fd;
+    data_ = data;
+    bytes_ = bytes;
+}
+
+} // namespace apr_system
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "types.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace apr_system {
+
+/**
+ * @brief on-disk record of fixes that worked in earlier runs
+ *
+ * a memory-mapped open-addressing hash file. every slot counts the
+ * plausible patches seen for one fix shape, keyed by the target's node
+ * type, a hash of its genealogy context and the operator (mutation
+ * category and source node type, or operator class). keys use a stable
+ * hash, so a file carries over between builds and machines of the same
+ * byte order.
+ *
+ * the mutator expands matching (target, rule) groups first and the
+ * prioritizer boosts matching candidates; the orchestrator records the
+ * plausible patches of a run. lookups may run concurrently, recording
+ * must not overlap with them. processes sharing a file serialize opening
+ * and recording on an exclusive flock; a process that mapped the file
+ * before another one grew it picks up the grown file when it next records.
+ */
+class KnowledgeBase {
+public:
+  // a fix shape stops gaining weight after this many successes
+  static constexpr uint32_t kMaxBoost = 8;
+
+  /**
+   * @brief map a knowledge base file, creating an empty one if missing
+   * @throws std::runtime_error if the file cannot be created, mapped or is
+   * not a knowledge base
+   */
+  static std::unique_ptr<KnowledgeBase> open(const std::string &path);
+
+  ~KnowledgeBase();
+  KnowledgeBase(const KnowledgeBase &) = delete;
+  KnowledgeBase &operator=(const KnowledgeBase &) = delete;
+
+  /**
+   * @brief order-independent stable hash of a genealogy context
+   */
+  static uint64_t genealogyHash(const GenealogyContext &genealogy);
+
+  /**
+   * @brief key of a fix shape, never 0
+   */
+  static uint64_t key(std::string_view node_type, uint64_t genealogy_hash,
+                      std::string_view mutation_category, std::string_view source_node);
+
+  /**
+   * @brief key of a candidate's fix shape
+   */
+  static uint64_t key(const PatchCandidate &patch);
+
+  /**
+   * @brief plausible patches recorded for a key
+   */
+  uint32_t successes(uint64_t key) const;
+
+  /**
+   * @brief score multiplier of a key, 1 + successes capped at kMaxBoost
+   */
+  double boost(uint64_t key) const {
+    return 1.0 + static_cast<double>(std::min(successes(key), kMaxBoost));
+  }
+
+  /**
+   * @brief count one more plausible patch for a key, growing the file when
+   * it gets half full
+   * @throws std::runtime_error if the file cannot be locked, reopened or
+   * grown
+   */
+  void recordSuccess(uint64_t key);
+
+  /**
+   * @brief number of distinct fix shapes
+   */
+  size_t size() const;
+
+  const std::string &path() const { return path_; }
+
+private:
+  struct Header;
+  struct Slot;
+
+  explicit KnowledgeBase(std::string path) : path_(std::move(path)) {}
+  void map(size_t bytes);
+  void validate();
+  void unmap();
+  void lock();
+  void unlock();
+  void grow();
+  Header &header() const;
+  Slot *slots() const;
+
+  std::string path_;
+  int fd_ = -1; // the mapped file, flock'ed while opening and recording
+  void *data_ = nullptr;
+  size_t bytes_ = 0;
+};
+
+} // namespace apr_system
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace apr_system {
+
+/**
+ * @brief number of worker threads to use
+ * @param requested requested count, 0 picks the hardware concurrency
+ * @return at least 1
+ */
+inline size_t resolveThreadCount(size_t requested) {
+  if (requested == 0) {
+    requested = std::thread::hardware_concurrency();
+  }
+  return std::max<size_t>(1, requested);
+}
+
+/**
+ * @brief run fn(worker, index) for every index in [0, n) on a pool of threads
+ *
+ * indices are handed out one at a time, so the order they run in is
+ * unspecified. callers keep results in per-index slots and merge them in
+ * index order afterwards, which makes the result independent of the thread
+ * count. worker is in [0, threads) and can select per-thread scratch space.
+ * the first exception thrown by fn is rethrown once all workers stopped.
+ *
+ * @param n number of indices
+ * @param threads worker count, see resolveThreadCount
+ * @param fn callable taking (size_t worker, size_t index)
+ */
+template <typename Fn>
+void parallelFor(size_t n, size_t threads, Fn &&fn) {
+  threads = std::min(resolveThreadCount(threads), n);
+  if (threads <= 1) {
+    for (size_t i = 0; i < n; ++i) {
+      fn(size_t{0}, i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next{0};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto work = [&](size_t worker) {
+    try {
+      for (size_t i = next++; i < n; i = next++) {
+        fn(worker, i);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error) error = std::current_exception();
+      next = n; // stop handing out work
+    }
+  };
+
+  std::vector<std::thread> pool;
+  pool.reserve(threads - 1);
+  for (size_t w = 1; w < threads; ++w) {
+    pool.emplace_back(work, w);
+  }
+  work(0);
+  for (auto &t : pool) {
+    t.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+/**
+ * @brief persistent worker threads for callers that run many small
+ * parallelFor-style jobs in a row
+ *
+ * the threads are started once and sleep between jobs, so a job costs a
+ * wakeup instead of a thread start and join per worker. the calling thread
+ * takes part in every job as worker 0. not reentrant: one job at a time.
+ */
+class ThreadPool {
+public:
+  /**
+   * @param threads worker count including the caller, see resolveThreadCount
+   */
+  explicit ThreadPool(size_t threads) {
+    threads = resolveThreadCount(threads);
+    workers_.reserve(threads - 1);
+    for (size_t w = 1; w < threads; ++w) {
+      workers_.emplace_back([this, w] { workerLoop(w); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto &t : workers_) {
+      t.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t size() const { return workers_.size() + 1; }
+
+  /**
+   * @brief run fn(worker, index) for every index in [0, n), same contract as
+   * parallelFor
+   */
+  template <typename Fn>
+  void run(size_t n, Fn &&fn) {
+    if (workers_.empty() || n <= 1) {
+      for (size_t i = 0; i < n; ++i) {
+        fn(size_t{0}, i);
+      }
+      return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    const std::function<void(size_t)> work = [&](size_t worker) {
+      try {
+        for (size_t i = next++; i < n; i = next++) {
+          fn(worker, i);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) error = std::current_exception();
+        next = n; // stop handing out work
+      }
+    };
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = &work;
+      active_ = workers_.size();
+      ++generation_;
+    }
+    wake_.notify_all();
+    work(0);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait(lock, [this] { return active_ == 0; });
+      job_ = nullptr;
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+private:
+  void workerLoop(size_t worker) {
+    size_t seen = 0;
+    while (true) {
+      const std::function<void(size_t)> *job = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_) return;
+        seen = generation_;
+        job = job_;
+      }
+      (*job)(worker);
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--active_ == 0) done_.notify_one();
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  // the running job, valid while active_ > 0
+  const std::function<void(size_t)> *job_ = nullptr;
+  size_t generation_ = 0;
+  size_t active_ = 0;
+  bool stop_ = false;
+};
+
+} // namespace apr_system
@@ -0,0 +1,135 @@
+#include "trace.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace apr_system {
+
+namespace {
+
+struct Record {
+    long long ts_us;
+    Trace::Stage stage;
+    const char *event;
+    nlohmann::json data;
+};
+
+const char *stage_name(Trace::Stage stage) {
+    switch (stage) {
+    case Trace::Stage::Parser: return "parser";
+    case Trace::Stage::Mutator: return "mutator";
+    case Trace::Stage::Prioritizer: return "prioritizer";
+    case Trace::Stage::Validator: return "validator";
+    }
+    return "unknown";
+}
+
+// Queue and writer thread behind the static Trace interface
+struct Sink {
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Record> pending;
+    bool stopping = false;
+    std::ofstream out;
+    std::thread writer;
+
+    void run() {
+        std::vector<Record> batch;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !pending.empty(); });
+                if (pending.empty() && stopping) break;
+                batch.swap(pending);
+            }
+            // serialization and I/O happen here, off the pipeline's threads
+            for (auto &record : batch) {
+                nlohmann::json line = {
+                    {"ts_us", record.ts_us},
+                    {"stage", stage_name(record.stage)},
+                    {"event", record.event},
+                    {"data", std::move(record.data)},
+                };
+                out << line.dump() << '\n';
+            }
+            batch.clear();
+        }
+        out.flush();
+    }
+
+    ~Sink() { stop(); }
+
+    void stop() {
+        if (!writer.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+        out.close();
+    }
+};
+
+Sink &sink() {
+    static Sink instance;
+    return instance;
+}
+
+} // namespace
+
+std::optional<unsigned> Trace::parseStages(const std::string &stages) {
+    unsigned mask = 0;
+    std::stringstream list(stages);
+    std::string name;
+    while (std::getline(list, name, ',')) {
+        if (name == "parser") mask |= static_cast<unsigned>(Stage::Parser);
+        else if (name == "mutator") mask |= static_cast<unsigned>(Stage::Mutator);
+        else if (name == "prioritizer") mask |= static_cast<unsigned>(Stage::Prioritizer);
+        else if (name == "validator") mask |= static_cast<unsigned>(Stage::Validator);
+        else if (name == "all") mask |= 0xFu;
+        else if (!name.empty()) return std::nullopt;
+    }
+    return mask;
+}
+
+void Trace::open(const std::string &path, unsigned stage_mask) {
+    close();
+    if (stage_mask == 0) return;
+
+    Sink &s = sink();
+    s.out.open(path, std::ios::out | std::ios::trunc);
+    if (!s.out) {
+        throw std::runtime_error("failed to open trace file: " + path);
+    }
+    s.stopping = false;
+    s.writer = std::thread([&s] { s.run(); });
+    mask_.store(stage_mask, std::memory_order_relaxed);
+}
+
+void Trace::close() {
+    mask_.store(0, std::memory_order_relaxed);
+    sink().stop();
+}
+
+void Trace::emit(Stage stage, const char *event, nlohmann::json data) {
+    if (!enabled(stage)) return;
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    Record record{std::chrono::duration_cast<std::chrono::microseconds>(now).count(), stage, event,
+                  std::move(data)};
+    Sink &s = sink();
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (s.stopping) return; // closed concurrently
+        s.pending.push_back(std::move(record));
+    }
+    s.wake.notify_one();
+}
+
+} // namespace apr_system
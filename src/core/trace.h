@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+namespace apr_system {
+
+/**
+ * @brief opt-in structured trace of pipeline internals
+ *
+ * replaces the text dumps components used to write on every run. records
+ * are written as NDJSON (one json object per line: ts_us, stage, event,
+ * data) by a background thread, so emitting only costs building the
+ * payload and a queue push. tracing is off by default and enabled per
+ * stage; call sites guard with enabled() so a disabled stage costs a
+ * single relaxed atomic load.
+ */
+class Trace {
+public:
+  enum class Stage : unsigned {
+    Parser = 1u << 0,
+    Mutator = 1u << 1,
+    Prioritizer = 1u << 2,
+    Validator = 1u << 3,
+  };
+
+  /**
+   * @brief parse a comma-separated stage list
+   * @param stages e.g. "mutator,prioritizer" or "all"
+   * @return stage bit mask, nullopt if a name is unknown
+   */
+  static std::optional<unsigned> parseStages(const std::string &stages);
+
+  /**
+   * @brief start tracing the given stages into a file
+   * @param path NDJSON output file, truncated
+   * @param stage_mask bit mask of Stage values, 0 keeps tracing off
+   * @throws std::runtime_error if the file cannot be opened
+   */
+  static void open(const std::string &path, unsigned stage_mask);
+
+  /**
+   * @brief write out pending records, stop the writer thread and disable
+   * tracing. safe to call when tracing was never opened
+   */
+  static void close();
+
+  /**
+   * @brief whether records of a stage are collected
+   */
+  static bool enabled(Stage stage) {
+    return (mask_.load(std::memory_order_relaxed) & static_cast<unsigned>(stage)) != 0;
+  }
+
+  /**
+   * @brief queue a record, dropped if the stage is disabled
+   * @param stage stage the record belongs to
+   * @param event record kind within the stage, e.g. "candidate"
+   * @param data payload, serialized on the writer thread
+   */
+  static void emit(Stage stage, const char *event, nlohmann::json data);
+
+private:
+  static inline std::atomic<unsigned> mask_{0};
+};
+
+} // namespace apr_system
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <vector>
@@ -14,6 +15,7 @@ struct SuspiciousLocation;
 struct ASTNode;
 struct PatchCandidate;
 struct PrioritizedPatch;
+struct RankedPatch;
 struct ValidationResult;
 
 /**
@@ -89,6 +91,23 @@ struct DependencyContext {
 };
 
 
+/**
+ * @brief names a node depends on and names visible at its position
+ */
+struct ScopeContext {
+  // parameters and block-local declarations outside the node its identifiers resolve to
+  std::vector<std::string> required_locals;
+  // class members its identifiers resolve to
+  std::vector<std::string> required_members;
+  // names visible at the start of the node, only filled in for suspicious nodes
+  std::vector<std::string> visible_names;
+  // inside an out-of-line member function, whose class members are unknown
+  bool open_members = false;
+
+  NLOHMANN_DEFINE_TYPE_INTRUSIVE(ScopeContext, required_locals, required_members,
+                                 visible_names, open_members)
+};
+
 /**
  * @brief ast node information
  */
@@ -99,19 +118,28 @@ struct ASTNode {
   int end_line;
   int start_column;
   int end_column;
+  int start_byte;
+  int end_byte;
   std::string file_path;
   std::string source_text;
   std::vector<std::string> child_node_ids;
   double suspiciousness_score;
   std::string sbfl_reason;
+  // the sbfl line that made the node suspicious, 0 if it is not
+  int suspicious_line = 0;
   GenealogyContext genealogy_context;
   VariableContext variable_context;
   DependencyContext dependency_context;
+  ScopeContext scope_context;
+  // declared type of the value the node evaluates to, empty when unknown
+  std::string inferred_type;
 
   NLOHMANN_DEFINE_TYPE_INTRUSIVE(ASTNode, node_id, node_type, start_line,
-                                 end_line, start_column, end_column, file_path,
+                                 end_line, start_column, end_column, start_byte,
+                                 end_byte, file_path,
                                  source_text, child_node_ids,suspiciousness_score,sbfl_reason, 
-                                 genealogy_context, variable_context, dependency_context)
+                                 suspicious_line, genealogy_context, variable_context, dependency_context,
+                                 scope_context, inferred_type)
 };
 
 /**
@@ -141,12 +169,26 @@ struct PatchCandidate {
   std::vector<std::string> affected_tests;
   double suspiciousness_score;
   double similarity_score;
-  double priority_score;
+  double priority_score = 0.0;
+  // hash of (file, edited byte range, normalized new text), equal for identical edits
+  std::uint64_t fingerprint = 0;
+  // context similarities behind similarity_score, 0 for operator mutations
+  double genealogy_similarity = 0.0;
+  double dependency_similarity = 0.0;
+  // sbfl line the target covers, 0 if unknown
+  int suspicious_line = 0;
+  // where the ingredient was taken from, empty for operator mutations
+  std::string ingredient_file;
+  int ingredient_line = 0;
+  // KnowledgeBase::genealogyHash of the target
+  std::uint64_t genealogy_hash = 0;
 
   NLOHMANN_DEFINE_TYPE_INTRUSIVE(PatchCandidate, patch_id, target_node_id, file_path,
                                  start_line, end_line, original_code,
                                  modified_code, diff, mutation_type,
-                                 affected_tests, similarity_score, suspiciousness_score, priority_score)
+                                 affected_tests, similarity_score, suspiciousness_score, priority_score,
+                                 fingerprint, genealogy_similarity, dependency_similarity,
+                                 suspicious_line, ingredient_file, ingredient_line, genealogy_hash)
 };
 
 
@@ -173,6 +215,19 @@ struct PrioritizedPatch {
                                  patch_id_ref, features, reasoning)
 };
 
+/**
+ * @brief one entry of the prioritizer's ranking, a view into the candidates
+ *
+ * the ranking orders indices into the patch candidate list instead of
+ * copying the candidates.
+ */
+struct RankedPatch {
+  size_t candidate;
+  double priority_score;
+
+  NLOHMANN_DEFINE_TYPE_INTRUSIVE(RankedPatch, candidate, priority_score)
+};
+
 /**
  * @brief validation result for a patch
  */
@@ -225,7 +280,8 @@ struct SystemState {
   std::vector<SuspiciousLocation> suspicious_locations;
   std::vector<ASTNode> ast_nodes;
   std::vector<PatchCandidate> patch_candidates;
-  std::vector<PatchCandidate> prioritized_patches;
+  // best first, indices into patch_candidates
+  std::vector<RankedPatch> prioritized_patches;
   std::vector<ValidationResult> validation_results;
   NLOHMANN_DEFINE_TYPE_INTRUSIVE(SystemState, repo_metadata,
                                  suspicious_locations, ast_nodes,
@@ -5,6 +5,7 @@
 #include <fmt/format.h>
 
 #include "core/logger.h"
+#include "core/trace.h"
 #include "orchestrator/orchestrator.h"
 #include "sbfl/sbfl.h"
 #include "parser/parser.h"
@@ -151,17 +152,61 @@ int main(int argc, char* argv[]) {
             LOG_INFO("repository URL: {}", args.repo_url);
             LOG_INFO("branch: {}", args.branch);
             LOG_INFO("sbfl json: {}", args.sbfl_json);
-            LOG_INFO("mutation frequency json: {}", args.mutation_freq_json);
+            LOG_INFO("mutation frequency json: {}",
+                     args.mutation_freq_json.empty() ? "(built-in)" : args.mutation_freq_json);
             LOG_INFO("buggy-program: {}", args.buggy_program_dir);
         }
 
+        // opt-in debug trace, replaces the old per-stage text dumps
+        if (const unsigned stages = *Trace::parseStages(args.trace_stages)) {
+            if (args.trace_file.empty()) {
+                std::filesystem::create_directories(args.output_dir);
+                args.trace_file = args.output_dir + "/trace.ndjson";
+            }
+            Trace::open(args.trace_file, stages);
+            LOG_INFO("tracing '{}' to: {}", args.trace_stages, args.trace_file);
+        }
+
+        // fixes from earlier runs, shared by the mutator, prioritizer and orchestrator
+        std::shared_ptr<KnowledgeBase> knowledge;
+        if (!args.knowledge_base.empty()) {
+            knowledge = KnowledgeBase::open(args.knowledge_base);
+            LOG_INFO("knowledge base: {} ({} fix shapes)", args.knowledge_base, knowledge->size());
+        }
+
         // create component instances
         auto sbfl = std::make_unique<SBFL>();
         auto parser = std::make_unique<Parser>();
-        // pass frequency file path to mutator so it doesn't rely on compile-time relative paths
-        auto mutator = std::make_unique<Mutator>(args.mutation_freq_json);
+        // mutator and prioritizer share one model, the compiled-in one unless --freq-json is given
+        auto frequencies = args.mutation_freq_json.empty() ? FrequencyModel::builtin()
+                                                           : FrequencyModel::load(args.mutation_freq_json);
+        auto mutator = std::make_unique<Mutator>(frequencies);
+        // a ranking model must see more than the mutator's own top candidates, otherwise the mutator's
+        // product picks what gets validated and the model only reorders it. without one the prioritizer
+        // scores with that same product, so its top is the mutator's top
+        const bool reranks = !args.ranking_model.empty();
+        // an interleaving validation queue needs candidates beyond the best few locations to move to
+        const bool interleaves = args.diversity > 0.0;
+        mutator->setMaxPatches(args.max_patches ? static_cast<size_t>(*args.max_patches)
+                               : reranks     ? Orchestrator::kRerankedCandidatePool
+                               : interleaves ? Orchestrator::kDiverseCandidatePool
+                                             : Orchestrator::kRankedCandidates);
+        mutator->setConfidenceThreshold(args.confidence_threshold);
+        mutator->setRetrievalTopM(static_cast<size_t>(args.ingredient_top_m));
+        mutator->setKnowledgeBase(knowledge);
         auto prioritizer = std::make_unique<Prioritizer>();
+        prioritizer->setFrequencyModel(frequencies);
+        prioritizer->setDiversity(args.diversity);
+        prioritizer->setKnowledgeBase(knowledge);
+        if (!args.ranking_model.empty()) {
+            LOG_INFO("ranking patches with model: {}", args.ranking_model);
+            prioritizer->setRankingModel(RankingModel::load(args.ranking_model));
+        }
         auto validator = std::make_unique<Validator>();
+        ValidationConfig validation_config = validator->getConfig();
+        validation_config.num_workers = args.validation_workers;
+        validation_config.workspace_dir = args.validation_workspace_dir;
+        validator->setConfig(validation_config);
       
         std::vector<TestResult> test_results;
         CoverageData coverage_data;
@@ -177,7 +222,9 @@ int main(int argc, char* argv[]) {
             LOG_INFO("running SBFL analysis");
             sbfl->runSBFLAnalysis(args.buggy_program_dir, args.sbfl_json);
 
-            if (std::filesystem::exists(args.mutation_freq_json)) {
+            if (args.mutation_freq_json.empty()) {
+                LOG_INFO("using built-in mutation frequencies");
+            } else if (std::filesystem::exists(args.mutation_freq_json)) {
                 LOG_INFO("loading mutation frequencies from: {}", args.mutation_freq_json);
             } else {
                 LOG_ERROR("mutation frequency file not found: {}", args.mutation_freq_json);
@@ -191,6 +238,9 @@ int main(int argc, char* argv[]) {
 
         // create orchestrator and set components
         auto orchestrator = std::make_unique<Orchestrator>();
+        orchestrator->setKnowledgeBase(knowledge);
+        // the interleaving queue draws from every generated candidate, not just the top by score
+        orchestrator->setRankedCandidates(interleaves ? 0 : Orchestrator::kRankedCandidates);
         orchestrator->setComponents(
             std::move(sbfl),
             std::move(parser),
@@ -235,15 +285,18 @@ int main(int argc, char* argv[]) {
         // set exit code based on whether patches were found
         if (system_state.validation_results.empty()) {
             LOG_WARN("no valid patches generated");
+            Trace::close();
             apr_system::Logger::shutdown();
             return 2; // no patches
         }
 
+        Trace::close();
         apr_system::Logger::shutdown();
         return 0;
 
     } catch (const std::exception& e) {
         LOG_CRITICAL("fatal error: {}", e.what());
+        Trace::close();
         apr_system::Logger::shutdown();
         return 1;
     }
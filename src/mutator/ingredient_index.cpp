@@ -0,0 +1,132 @@
+#include "ingredient_index.h"
+#include <algorithm>
+#include <limits>
+#include <string_view>
+#include <unordered_set>
+
+namespace apr_system {
+
+namespace {
+
+// splitmix64 finalizer, a cheap well-mixed 64-bit hash
+uint64_t mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+uint64_t hash_token(char kind, std::string_view text, uint64_t occurrence) {
+    uint64_t h = 14695981039346656037ull;
+    h = (h ^ static_cast<unsigned char>(kind)) * 1099511628211ull;
+    for (char c : text) {
+        h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return mix64(h ^ (occurrence * 0x2545f4914f6cdd1dull));
+}
+
+uint64_t band_hash(const IngredientIndex::Signature &sig, size_t band, size_t rows) {
+    uint64_t h = band;
+    for (size_t r = 0; r < rows; ++r) {
+        h = mix64(h ^ sig[band * rows + r]);
+    }
+    return h;
+}
+
+} // namespace
+
+std::vector<uint64_t> IngredientIndex::tokens(const GenealogyContext &genealogy,
+                                              const DependencyContext &dependency,
+                                              const VariableContext &variables) {
+    // counts become repeated tokens, so Jaccard over the sets follows the min-sum similarity
+    std::vector<uint64_t> result;
+    for (const auto &kv : genealogy.type_counts) {
+        for (int i = 0; i < kv.second; ++i) result.push_back(hash_token('g', kv.first, i));
+    }
+    for (const auto &kv : dependency.slice_counts) {
+        for (int i = 0; i < kv.second; ++i) result.push_back(hash_token('d', kv.first, i));
+    }
+    for (const auto &kv : variables.var_counts) {
+        result.push_back(hash_token('v', kv.first, 0));
+    }
+    return result;
+}
+
+IngredientIndex::Signature IngredientIndex::signature(const std::vector<uint64_t> &tokens) {
+    Signature sig;
+    sig.fill(std::numeric_limits<uint32_t>::max());
+    for (uint64_t token : tokens) {
+        for (size_t i = 0; i < kHashes; ++i) {
+            const uint32_t h = static_cast<uint32_t>(mix64(token + i * 0x9e3779b97f4a7c15ull) >> 32);
+            sig[i] = std::min(sig[i], h);
+        }
+    }
+    return sig;
+}
+
+void IngredientIndex::add(size_t id, const Signature &sig) {
+    const uint32_t position = static_cast<uint32_t>(ids_.size());
+    ids_.push_back(id);
+    signatures_.push_back(sig);
+    for (size_t level = 0; level < kLevelRows.size(); ++level) {
+        const size_t rows = kLevelRows[level];
+        auto &bands = levels_[level];
+        bands.resize(kHashes / rows);
+        for (size_t band = 0; band < bands.size(); ++band) {
+            bands[band][band_hash(sig, band, rows)].push_back(position);
+        }
+    }
+}
+
+std::vector<size_t> IngredientIndex::query(const Signature &sig, size_t top_m) const {
+    auto estimate = [&](uint32_t position) {
+        const Signature &other = signatures_[position];
+        uint32_t equal = 0;
+        for (size_t i = 0; i < kHashes; ++i) equal += other[i] == sig[i];
+        return equal;
+    };
+
+    const size_t budget = kProbeFactor * top_m;
+    std::unordered_set<uint32_t> seen;
+    seen.reserve(budget);
+    std::vector<std::pair<uint32_t, uint32_t>> scored; // (estimate, position)
+    scored.reserve(budget);
+    // a banding only runs when the narrower ones collided with too few ingredients
+    for (size_t level = 0; level < kLevelRows.size() && scored.size() < top_m; ++level) {
+        const auto &bands = levels_[level];
+        for (size_t band = 0; band < bands.size() && scored.size() < budget; ++band) {
+            auto it = bands[band].find(band_hash(sig, band, kLevelRows[level]));
+            if (it == bands[band].end()) continue;
+            for (uint32_t position : it->second) {
+                if (scored.size() >= budget) break;
+                if (!seen.insert(position).second) continue;
+                scored.emplace_back(estimate(position), position);
+            }
+        }
+    }
+
+    const size_t keep = std::min(top_m, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + keep, scored.end(), [](const auto &a, const auto &b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+
+    std::vector<size_t> result;
+    result.reserve(keep);
+    for (size_t i = 0; i < keep; ++i) {
+        result.push_back(ids_[scored[i].second]);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<size_t> IngredientIndex::spread(size_t n) const {
+    n = std::min(n, ids_.size());
+    std::vector<size_t> result;
+    result.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        result.push_back(ids_[i * ids_.size() / n]);
+    }
+    return result;
+}
+
+} // namespace apr_system
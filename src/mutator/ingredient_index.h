@@ -0,0 +1,84 @@
+#pragma once
+
+#include "../core/types.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace apr_system {
+
+/**
+ * @brief MinHash/LSH index for retrieving context-similar ingredients
+ *
+ * every ingredient is reduced to a set of tokens (node types of its
+ * genealogy and dependency contexts, one token per occurrence, plus its
+ * variables) and a MinHash signature over that set. signatures are split
+ * into bands for locality-sensitive hashing, so a query only looks at
+ * ingredients that share at least one band with the target. the signature
+ * is banded several times, with fewer rows per band each time; a query
+ * that finds too few collisions widens to the next banding instead of
+ * scanning the whole index.
+ */
+class IngredientIndex {
+public:
+  static constexpr size_t kBands = 16;
+  static constexpr size_t kRows = 4;
+  static constexpr size_t kHashes = kBands * kRows;
+  // rows per band of each banding, narrowest (most selective) first
+  static constexpr std::array<size_t, 3> kLevelRows = {kRows, 2, 1};
+  // a query estimates at most this many times top_m signatures
+  static constexpr size_t kProbeFactor = 4;
+  using Signature = std::array<uint32_t, kHashes>;
+
+  /**
+   * @brief tokens of a context, see the class description
+   */
+  static std::vector<uint64_t> tokens(const GenealogyContext &genealogy,
+                                      const DependencyContext &dependency,
+                                      const VariableContext &variables);
+
+  /**
+   * @brief MinHash signature of a token set
+   */
+  static Signature signature(const std::vector<uint64_t> &tokens);
+
+  /**
+   * @brief add an ingredient
+   * @param id caller's id for the ingredient
+   * @param sig its signature
+   */
+  void add(size_t id, const Signature &sig);
+
+  size_t size() const { return ids_.size(); }
+
+  /**
+   * @brief ingredients most similar to a target
+   *
+   * candidates come from the LSH buckets the target falls into and are
+   * ranked by estimated Jaccard similarity (share of equal signature
+   * entries). if the buckets hold fewer than top_m ingredients, the wider
+   * bandings are probed as well. at most kProbeFactor * top_m candidates
+   * are estimated, so the cost does not grow with the index.
+   *
+   * @param sig signature of the target
+   * @param top_m number of ingredients to return
+   * @return ids of at most top_m ingredients, in ascending order
+   */
+  std::vector<size_t> query(const Signature &sig, size_t top_m) const;
+
+  /**
+   * @brief ids of n ingredients spread evenly over the index, in ascending
+   * insertion order, for rules that do not favour similar contexts
+   */
+  std::vector<size_t> spread(size_t n) const;
+
+private:
+  std::vector<size_t> ids_;
+  std::vector<Signature> signatures_;
+  // per banding, band hash -> positions in ids_, one table per band
+  std::array<std::vector<std::unordered_map<uint64_t, std::vector<uint32_t>>>, kLevelRows.size()> levels_;
+};
+
+} // namespace apr_system
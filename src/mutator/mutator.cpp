@@ -1,5 +1,16 @@
 #include "mutator.h"
 #include "../core/logger.h"
+#include "../core/parallel.h"
+#include "../core/trace.h"
+#include "similarity_kernels.h"
+#include "ingredient_index.h"
+#include "operator_mutations.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <tuple>
+#include <unordered_set>
 
 namespace apr_system
 {
@@ -10,184 +21,738 @@ std::string Mutator::makeDiff(int startLine, const std::string &orig, const std:
     int origLineCount = std::count(orig.begin(), orig.end(), '\n') + 1;
     int modLineCount = std::count(mod.begin(), mod.end(), '\n') + 1;
 
-    // Begin the header
-    std::ostringstream diff;
-    diff << "@@ -" << startLine << "," << origLineCount
-        << " +" << startLine << "," << modLineCount << " @@\n";
+    // Begin the header, sized up front so the whole diff is a single allocation
+    std::string diff;
+    diff.reserve(48 + orig.size() + mod.size() + 2 * (origLineCount + modLineCount));
+    diff += "@@ -" + std::to_string(startLine) + "," + std::to_string(origLineCount)
+        + " +" + std::to_string(startLine) + "," + std::to_string(modLineCount) + " @@\n";
 
-    // Emit each original line prefixed with '-'
-    {
-        std::istringstream in(orig);
-        std::string line;
-        while (std::getline(in, line)){
-            diff << "-" << line << "\n";
+    // Emit each line prefixed with '-' or '+' (a trailing newline does not start another line)
+    auto emit_lines = [&diff](const std::string &text, char prefix){
+        size_t pos = 0;
+        while (pos < text.size()){
+            size_t end = text.find('\n', pos);
+            if (end == std::string::npos) end = text.size();
+            diff += prefix;
+            diff.append(text, pos, end - pos);
+            diff += '\n';
+            pos = end + 1;
         }
+    };
+    emit_lines(orig, '-');
+    emit_lines(mod, '+');
+
+    return diff;
+}
+
+void Mutator::buildRuleTable(){
+    rules_by_target_.clear();
+    if (!frequencies_) return;
+    auto add = [this](const std::string &target, RuleKind kind, const std::string &source, double freq){
+        auto &rules = rules_by_target_[target];
+        for (auto &r : rules){
+            if (r.kind == kind && r.source_node == source){
+                r.freq = freq;
+                return;
+            }
+        }
+        rules.push_back({kind, source, freq});
+    };
+
+    // Replacement entries only name the target, the ingredient must have the same type
+    using Category = FrequencyModel::Category;
+    for (auto &e : frequencies_->entries(Category::Replacement)) add(e.target_node, RuleKind::Replacement, e.target_node, e.freq);
+    for (auto &e : frequencies_->entries(Category::Insertion)) add(e.target_node, RuleKind::Insertion, e.source_node, e.freq);
+    for (auto &e : frequencies_->entries(Category::Deletion)) add(e.target_node, RuleKind::Deletion, e.source_node, e.freq);
+    for (auto &e : frequencies_->entries(Category::Operator)) add(e.target_node, RuleKind::Operator, e.source_node, e.freq);
+}
+
+// Helper, whether a quote that follows text opens a raw string literal (R"...", u8R"...", LR"..." ...)
+static bool opensRawString(const std::string &text){
+    if (text.empty() || text.back() != 'R') return false;
+    size_t prefix = text.size() - 1;
+    for (const char *encoding : {"u8", "u", "U", "L"}){
+        const size_t length = std::char_traits<char>::length(encoding);
+        if (prefix >= length && text.compare(prefix - length, length, encoding) == 0){
+            prefix -= length;
+            break;
+        }
+    }
+    return prefix == 0 || !(std::isalnum(static_cast<unsigned char>(text[prefix - 1])) || text[prefix - 1] == '_');
+}
+
+// Helper, whether a single quote that follows text is a digit separator (1'000) rather than a char literal
+static bool isDigitSeparator(const std::string &text){
+    size_t start = text.size();
+    while (start > 0 && (std::isalnum(static_cast<unsigned char>(text[start - 1])) ||
+                         text[start - 1] == '_' || text[start - 1] == '\'' || text[start - 1] == '.')){
+        --start;
+    }
+    return start < text.size() && std::isdigit(static_cast<unsigned char>(text[start]));
+}
+
+// Helper, end of the string or char literal whose opening quote is at text[open]
+static size_t literalEnd(const std::string &text, size_t open, bool raw){
+    if (raw){
+        // R"delim( ... )delim"
+        const size_t paren = text.find('(', open + 1);
+        if (paren == std::string::npos) return text.size();
+        const std::string closing = ")" + text.substr(open + 1, paren - open - 1) + "\"";
+        const size_t close = text.find(closing, paren + 1);
+        return close == std::string::npos ? text.size() : close + closing.size();
+    }
+    const char quote = text[open];
+    for (size_t i = open + 1; i < text.size(); ++i){
+        if (text[i] == '\\') ++i;
+        else if (text[i] == quote || text[i] == '\n') return i + 1;
     }
+    return text.size();
+}
+
+std::string Mutator::normalizeText(const std::string &text){
+    std::string normalized;
+    normalized.reserve(text.size());
+    bool pending_space = false;
+    size_t i = 0;
+    while (i < text.size()){
+        const char c = text[i];
+        if (std::isspace(static_cast<unsigned char>(c))){
+            pending_space = !normalized.empty();
+            ++i;
+            continue;
+        }
+        if (pending_space){
+            normalized += ' ';
+            pending_space = false;
+        }
+        // whitespace inside a literal is part of its value, the literal is kept verbatim
+        if (c == '"' || (c == '\'' && !isDigitSeparator(normalized))){
+            const size_t end = literalEnd(text, i, c == '"' && opensRawString(normalized));
+            normalized.append(text, i, end - i);
+            i = end;
+            continue;
+        }
+        normalized += c;
+        ++i;
+    }
+    return normalized;
+}
 
-    // Emit each modified line prefixed with '+'
-    {
-        std::istringstream in(mod);
-        std::string line;
-        while (std::getline(in, line)){
-            diff << "+" << line << "\n";
+std::string Mutator::typeFamily(const std::string &type){
+    // words of the type without qualifiers, '*' kept as separate words
+    std::vector<std::string> words;
+    bool std_class = false;
+    std::string word;
+    auto flush = [&](){
+        if (word.rfind("std::", 0) == 0){
+            word.erase(0, 5);
+            std_class = true;
+        }
+        if (!word.empty() && word != "const" && word != "volatile"){
+            words.push_back(word);
         }
+        word.clear();
+    };
+    for (char c : type){
+        if (c == '<') break; // template arguments do not change the family
+        if (std::isspace(static_cast<unsigned char>(c)) || c == '&'){
+            flush();
+        } else if (c == '*'){
+            flush();
+            words.emplace_back("*");
+        } else {
+            word += c;
+        }
+    }
+    flush();
+    if (words.empty()) return "";
+
+    const size_t pointers = std::count(words.begin(), words.end(), "*");
+    std::erase(words, "*");
+    if (words.size() == 1 && (words[0] == "string" || words[0] == "string_view")){
+        return pointers == 0 ? "string" : "pointer";
+    }
+    if (pointers > 0){
+        return pointers == 1 && words.size() == 1 && words[0] == "char" ? "string" : "pointer";
     }
 
-    return diff.str();
+    static const std::unordered_set<std::string> arithmetic = {
+        "bool", "char", "short", "int", "long", "signed", "unsigned", "float", "double",
+        "size_t", "ssize_t", "ptrdiff_t", "intptr_t", "uintptr_t", "wchar_t", "char8_t",
+        "char16_t", "char32_t"};
+    const bool numeric = std::all_of(words.begin(), words.end(), [](const std::string &w){
+        if (arithmetic.count(w)) return true;
+        // fixed width integers, int32_t, uint_fast8_t, ...
+        return (w.rfind("int", 0) == 0 || w.rfind("uint", 0) == 0) && w.size() > 2 &&
+               w.compare(w.size() - 2, 2, "_t") == 0;
+    });
+    if (numeric) return "numeric";
+    if (std_class && words.size() == 1) return "std::" + words[0];
+    return "";
 }
 
-std::vector<PatchCandidate> Mutator::generatePatches(
-    const std::vector<ASTNode> &ast_nodes,
-    const std::vector<std::string> &source_files){
-    LOG_COMPONENT_INFO("mutator", "input: {} AST nodes, {} source files",
-                        ast_nodes.size(), source_files.size());
+std::uint64_t Mutator::fingerprint(const std::string &file_path, int start_byte,
+                                   int end_byte, const std::string &new_text){
+    // FNV-1a over the file, the range and the normalized text
+    std::uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void *data, size_t size){
+        auto *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; ++i){
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    mix(file_path.data(), file_path.size());
+    mix("\0", 1);
+    mix(&start_byte, sizeof(start_byte));
+    mix(&end_byte, sizeof(end_byte));
+    const std::string text = normalizeText(new_text);
+    mix(text.data(), text.size());
+    return hash;
+}
 
-    // Split up the vector of nodes into fix-ingredients and suspicious nodes
-    std::vector<const ASTNode *> targets, ingredients;
-    for (auto &node : ast_nodes){     
-        // Building up the fix-ingredients to be ALL the nodes in the file, not just the non-suspicious nodes
-        // Since supsicious nodes are all probalistic, there will be a handful of suspicious nodes that are actually valid and not broken
-        // so it makes sense to include them in the overall pool of fix ingredients
-        ingredients.push_back(&node);
-        if (node.suspiciousness_score > 0.0){
-            targets.push_back(&node);
+/**
+ * Everything the generator needs about one batch of AST nodes.
+ *
+ * For each target (suspicious node), the rules for its node type are applied to the bucket of
+ * ingredients whose type the rule draws from:
+ *
+ *   Replacement:
+ *     - Applies when the Replacement frequencies have an entry whose target_node matches t->node_type.
+ *     - Only considers source (fix ingredient) nodes s where s->node_type == t->node_type.
+ *     - Skip any multi line replacements (Only considering single-line patches for now)
+ *     - Build a diff, compute replacement similarity (genealogy × dependency × variable),
+ *       record suspiciousness and similarity scores.
+ *
+ *   Insertion:
+ *     - Insertion entries matching t->node_type and s->node_type.
+ *     - Skip multi‐line insertions
+ *     - Construct the diff with orig="" and mod = s->source_text.
+ *     - Compute insertion similarity (genealogy × dependency) and record the scores
+ *
+ *   Deletion:
+ *     - Deletion entries matching t->node_type and s->node_type.
+ *     - Skip multi‐line deletions.
+ *     - Construct the diff with mod="" and orig = t->source_text.
+ *     - Compute deletion similarity (genealogy × dependency), record scores.
+ *
+ *   Operator:
+ *     - Operator entries matching t->node_type, the source names an operator class.
+ *     - No ingredient, the rewrites come from operatorMutations(t) and replace the target.
+ *     - Similarity is 1.0, the priority is suspiciousness × freq.
+ *
+ * Every (target, rule) pair is a group with an upper bound on the priority of its candidates:
+ * suspiciousness × freq × the largest similarity the operator can produce (1.0, except for
+ * replacements whose variable factor can reach the target's variable count). Groups are expanded
+ * in descending bound order and a candidate is only yielded once no unexpanded group can beat it.
+ * Ties are broken by group order and then ingredient order, so the sequence is a fixed total order
+ * no matter how many groups were expanded ahead of time or by how many threads.
+ */
+struct Mutator::CandidateGenerator::State {
+    struct IngredientClass {
+        const ASTNode *representative;
+        std::string normalized_text;
+        GenealogyContext genealogy;
+        DependencyContext dependency;
+        // every node of the class, in pool order
+        std::vector<const ASTNode *> instances;
+        // names every member needs at its own location (intersection over members)
+        std::vector<std::string> required_locals;
+        std::vector<std::string> required_members;
+        // typeFamily of the value, "" when unknown or when members disagree
+        std::string type_family;
+    };
+    struct Group {
+        size_t target;
+        const Rule *rule;
+        double bound;
+        // knowledge base multiplier of the group's fix shape, part of bound
+        double boost = 1.0;
+    };
+    struct PairSimilarity {
+        double genealogy = 0.0;
+        double dependency = 0.0;
+    };
+    /**
+     * Candidates are enumerated in this form and only turned into a PatchCandidate (ids, text, diff)
+     * when they are yielded. The group identifies the target and the rule; ingredient indices grow
+     * within a bucket, so they double as the order inside a group.
+     */
+    struct CompactCandidate {
+        uint32_t group;
+        uint32_t ingredient;
+        float similarity;
+        float priority;
+    };
+    static_assert(sizeof(CompactCandidate) == 16);
+
+    size_t num_threads = 0;
+    // started on the first expansion and kept for the generator's lifetime, batches are small and many
+    std::optional<ThreadPool> pool;
+    double confidence_threshold = 0.0;
+    size_t retrieval_top_m = 0;
+
+    std::vector<const ASTNode *> targets;
+    // names visible at each target
+    std::vector<std::unordered_set<std::string>> target_visible;
+    std::vector<std::string> target_families;
+    std::vector<uint64_t> target_genealogy;
+    std::vector<IngredientClass> classes;
+    // Class indices bucketed by node type, every rule only ever looks at one bucket
+    std::unordered_map<std::string, std::vector<size_t>> ingredients_by_type;
+    ContextVocabulary vocabulary;
+    std::optional<DenseContexts> dense;
+
+    std::vector<Group> groups;
+    size_t next_group = 0;
+    // Genealogy and dependency similarity of a (target, class) pair is shared by all rules of the target
+    std::vector<std::unordered_map<size_t, PairSimilarity>> pair_cache;
+    // Rewrites of each Operator group, filled when the group is expanded; a candidate's ingredient
+    // index points into its group's list
+    std::vector<std::vector<std::string>> operator_rewrites;
+
+    // LSH indexes for buckets larger than retrieval_top_m, keyed by node type, and the ingredients
+    // retrieved for each target (per source node type, deletions separately)
+    std::unordered_map<std::string, IngredientIndex> indexes;
+    std::vector<IngredientIndex::Signature> target_signatures;
+    std::vector<std::unordered_map<std::string, std::vector<size_t>>> retrieved;
+
+    std::vector<CompactCandidate> heap;
+    std::unordered_set<std::uint64_t> emitted;
+    size_t yielded = 0;
+    std::atomic<size_t> rejected{0};
+    std::atomic<size_t> considered{0};
+
+    // Max-heap order: higher priority first, then earlier group, then earlier ingredient
+    static bool lowerPriority(const CompactCandidate &a, const CompactCandidate &b){
+        if (a.priority != b.priority) return a.priority < b.priority;
+        if (a.group != b.group) return a.group > b.group;
+        return a.ingredient > b.ingredient;
+    }
+
+    static const char *categoryName(RuleKind kind){
+        switch (kind){
+        case RuleKind::Replacement: return "Replacement";
+        case RuleKind::Insertion: return "Insertion";
+        case RuleKind::Deletion: return "Deletion";
+        case RuleKind::Operator: return "Operator";
         }
+        return "";
     }
 
-    // Helpful for debugging, prints out all suspicious nodes and fix ingredients into text files in the build directory
-    dumpSuspiciousNodes(targets);
-    dumpFixIngredients(ingredients);
+    const std::vector<size_t> &ingredientsFor(const Group &group);
+    bool inScope(size_t target, const IngredientClass &ingredient) const;
+    // Simi_R / Simi_I / Simi_D of a (group, ingredient class) pair, 1.0 for operator rewrites
+    double similarityOf(const Group &group, size_t idx, const PairSimilarity &sim) const;
+    void expandGroup(size_t group_idx, std::vector<CompactCandidate> &out);
+    void expandNextBatch();
+    PatchCandidate materialize(const CompactCandidate &compact) const;
+    static const ASTNode *nearestInstance(const IngredientClass &ingredient, const ASTNode *target);
+};
 
-    std::vector<PatchCandidate> patch_candidates;
-    int id_counter = 0;
+const std::vector<size_t> &Mutator::CandidateGenerator::State::ingredientsFor(const Group &group){
+    const std::vector<size_t> &bucket = ingredients_by_type.at(group.rule->source_node);
+    auto index = indexes.find(group.rule->source_node);
+    if (index == indexes.end()) return bucket;
+
+    const bool deletion = group.rule->kind == RuleKind::Deletion;
+    auto [it, inserted] = retrieved[group.target].try_emplace(deletion ? group.rule->source_node + "#deletion" : group.rule->source_node);
+    if (!inserted) return it->second;
+    if (!deletion){
+        it->second = index->second.query(target_signatures[group.target], retrieval_top_m);
+        return it->second;
+    }
+    // Deletions favour dissimilar ingredients, which the index cannot retrieve. The nearest half still
+    // finds indistinguishable ones (Simi_D = 1.0), an even spread of the bucket stands in for the rest.
+    std::vector<size_t> &list = it->second;
+    list = index->second.query(target_signatures[group.target], (retrieval_top_m + 1) / 2);
+    for (size_t idx : index->second.spread(retrieval_top_m)){
+        if (list.size() >= retrieval_top_m) break;
+        if (std::find(list.begin(), list.end(), idx) == list.end()) list.push_back(idx);
+    }
+    std::sort(list.begin(), list.end());
+    return list;
+}
+
+bool Mutator::CandidateGenerator::State::inScope(size_t target, const IngredientClass &ingredient) const {
+    const auto &visible = target_visible[target];
+    for (const auto &name : ingredient.required_locals){
+        if (!visible.count(name)) return false;
+    }
+    // members can only be checked when the target's class is known
+    if (!targets[target]->scope_context.open_members){
+        for (const auto &name : ingredient.required_members){
+            if (!visible.count(name)) return false;
+        }
+    }
+    return true;
+}
+
+double Mutator::CandidateGenerator::State::similarityOf(const Group &group, size_t idx, const PairSimilarity &sim) const {
+    switch (group.rule->kind){
+    case RuleKind::Replacement:
+        // Simi_R = f_gen * f_dep * d_var
+        return sim.genealogy * sim.dependency * dense->variableSimilarity(idx, classes.size() + group.target);
+    case RuleKind::Insertion:
+        // Simi_I = f_gen * f_dep
+        return sim.genealogy * sim.dependency;
+    case RuleKind::Deletion:
+        // Simi_D = (1 − f_gen) * (1 − f_dep), 1.0 when the other node is indistinguishable from the target
+        return (sim.genealogy == 1.0 && sim.dependency == 1.0)
+            ? 1.0 : (1.0 - sim.genealogy) * (1.0 - sim.dependency);
+    case RuleKind::Operator:
+        break; // no ingredient, the rewrite replaces the target as is
+    }
+    return 1.0;
+}
+
+void Mutator::CandidateGenerator::State::expandGroup(size_t group_idx, std::vector<CompactCandidate> &out){
+    const Group &group = groups[group_idx];
+    const ASTNode *t = targets[group.target];
+    const size_t target_row = classes.size() + group.target;
+    const Rule &rule = *group.rule;
+    const std::string target_text = normalizeText(t->source_text);
+    const std::string &target_family = target_families[group.target];
+    auto &cache = pair_cache[group.target];
+
+    if (rule.kind == RuleKind::Operator){
+        const double priority = t->suspiciousness_score * rule.freq * group.boost;
+        if (priority < confidence_threshold) return;
+        auto &rewrites = operator_rewrites[group_idx];
+        for (auto &mutation : operatorMutations(t->node_type, t->source_text)){
+            if (mutation.operator_class != rule.source_node) continue;
+            out.push_back({static_cast<uint32_t>(group_idx), static_cast<uint32_t>(rewrites.size()),
+                           1.0f, static_cast<float>(priority)});
+            rewrites.push_back(std::move(mutation.text));
+        }
+        return;
+    }
+
+    const std::vector<size_t> &ingredients = ingredientsFor(group);
+    considered += ingredients.size();
+    for (size_t idx : ingredients){
+        const ASTNode *s = classes[idx].representative;
+        if (s->source_text.find('\n') != std::string::npos) continue; // skip multi-line edits
+        if (rule.kind == RuleKind::Replacement && target_text == classes[idx].normalized_text) continue; // skip patches with the exact same code as the original (avoid duplicates)
+        // Splicing in names that do not exist at the target is a guaranteed compile error
+        if (rule.kind != RuleKind::Deletion && !inScope(group.target, classes[idx])){
+            rejected++;
+            continue;
+        }
+        // Same for replacing a value by one of another type family (a string for an int)
+        if (rule.kind == RuleKind::Replacement && !target_family.empty() && !classes[idx].type_family.empty() &&
+            target_family != classes[idx].type_family){
+            rejected++;
+            continue;
+        }
+
+        auto [cached, inserted] = cache.try_emplace(idx);
+        PairSimilarity &sim = cached->second;
+        if (inserted){
+            sim.genealogy = dense->genealogySimilarity(idx, target_row);
+            sim.dependency = dense->dependencySimilarity(idx, target_row);
+        }
+
+        const double similarity = similarityOf(group, idx, sim);
+        const double priority = similarity * t->suspiciousness_score * rule.freq * group.boost;
+        if (priority < confidence_threshold) continue; // never constructed
+
+        out.push_back({static_cast<uint32_t>(group_idx), static_cast<uint32_t>(idx),
+                       static_cast<float>(similarity), static_cast<float>(priority)});
+    }
+}
+
+const ASTNode *Mutator::CandidateGenerator::State::nearestInstance(const IngredientClass &ingredient,
+                                                                  const ASTNode *target){
+    // same file first, then the smallest line distance, then pool order; the target itself only as a last resort
+    const ASTNode *best = nullptr;
+    auto rank = [target](const ASTNode *node){
+        return std::make_tuple(node == target, node->file_path != target->file_path,
+                               std::abs(node->start_line - target->start_line));
+    };
+    for (const ASTNode *node : ingredient.instances){
+        if (!best || rank(node) < rank(best)) best = node;
+    }
+    return best ? best : ingredient.representative;
+}
+
+PatchCandidate Mutator::CandidateGenerator::State::materialize(const CompactCandidate &compact) const {
+    const Group &group = groups[compact.group];
+    const ASTNode *t = targets[group.target];
+    const bool has_ingredient = group.rule->kind != RuleKind::Operator;
+    const ASTNode *s = has_ingredient ? classes[compact.ingredient].representative : nullptr;
+
+    PatchCandidate p;
+    p.target_node_id   = t->node_id;
+    p.file_path = t->file_path;
+    p.start_line = t->start_line;
+    p.end_line = t->end_line;
+    p.mutation_type.target_node = t->node_type;
+    p.mutation_type.source_node = has_ingredient ? s->node_type : group.rule->source_node;
+    p.suspiciousness_score = t->suspiciousness_score;
+    p.suspicious_line = t->suspicious_line;
+    p.genealogy_hash = target_genealogy[group.target];
+    // The compact floats only order the heap, the emitted scores are recomputed in full precision
+    // from the pair's context similarities, which expandGroup cached when it scored the candidate
+    PairSimilarity sim;
+    if (has_ingredient){
+        sim = pair_cache[group.target].at(compact.ingredient);
+        p.genealogy_similarity = sim.genealogy;
+        p.dependency_similarity = sim.dependency;
+        // the text is the same for every member, the locality features describe the one nearest the target
+        const ASTNode *nearest = nearestInstance(classes[compact.ingredient], t);
+        p.ingredient_file = nearest->file_path;
+        p.ingredient_line = nearest->start_line;
+    }
+    p.similarity_score = has_ingredient ? similarityOf(group, compact.ingredient, sim) : 1.0;
+    p.priority_score = p.similarity_score * t->suspiciousness_score * group.rule->freq * group.boost;
+    switch (group.rule->kind){
+    case RuleKind::Replacement:
+        p.original_code = t->source_text;
+        p.modified_code = s->source_text;
+        p.mutation_type.mutation_category = "Replacement";
+        break;
+    case RuleKind::Insertion:
+        p.end_line = t->start_line;
+        p.original_code = "";
+        p.modified_code = s->source_text;
+        p.mutation_type.mutation_category = "Insertion";
+        break;
+    case RuleKind::Deletion:
+        p.original_code = t->source_text;
+        p.modified_code = "";
+        p.mutation_type.mutation_category = "Deletion";
+        break;
+    case RuleKind::Operator:
+        p.original_code = t->source_text;
+        p.modified_code = operator_rewrites[compact.group][compact.ingredient];
+        p.mutation_type.mutation_category = "Operator";
+        break;
+    }
+    const int edit_end = group.rule->kind == RuleKind::Insertion ? t->start_byte : t->end_byte;
+    p.fingerprint = fingerprint(t->file_path, t->start_byte, edit_end, p.modified_code);
+    return p;
+}
+
+void Mutator::CandidateGenerator::State::expandNextBatch(){
+    // Expand as many groups as there are workers, one target per worker so a target's pair cache
+    // is only ever touched by one thread
+    if (!pool) pool.emplace(num_threads);
+    const size_t batch_end = std::min(groups.size(), next_group + pool->size());
+    std::vector<size_t> batch_targets;
+    std::unordered_map<size_t, std::vector<size_t>> groups_of_target;
+    for (size_t g = next_group; g < batch_end; ++g){
+        if (groups[g].bound < confidence_threshold) break;
+        auto &list = groups_of_target[groups[g].target];
+        if (list.empty()) batch_targets.push_back(groups[g].target);
+        list.push_back(g);
+    }
+
+    std::vector<std::vector<CompactCandidate>> expanded(batch_targets.size());
+    pool->run(batch_targets.size(), [&](size_t, size_t i){
+        for (size_t g : groups_of_target[batch_targets[i]]){
+            expandGroup(g, expanded[i]);
+        }
+    });
+
+    for (auto &list : groups_of_target) next_group += list.second.size();
+    for (auto &out : expanded){
+        for (auto &compact : out){
+            heap.push_back(compact);
+            std::push_heap(heap.begin(), heap.end(), lowerPriority);
+        }
+    }
+}
+
+Mutator::CandidateGenerator::CandidateGenerator(std::unique_ptr<State> state) : state_(std::move(state)) {}
+Mutator::CandidateGenerator::CandidateGenerator(CandidateGenerator &&) noexcept = default;
+Mutator::CandidateGenerator &Mutator::CandidateGenerator::operator=(CandidateGenerator &&) noexcept = default;
+Mutator::CandidateGenerator::~CandidateGenerator() = default;
+
+size_t Mutator::CandidateGenerator::expandedGroups() const { return state_->next_group; }
+size_t Mutator::CandidateGenerator::totalGroups() const { return state_->groups.size(); }
+size_t Mutator::CandidateGenerator::rejectedCandidates() const { return state_->rejected; }
+size_t Mutator::CandidateGenerator::consideredIngredients() const { return state_->considered; }
+
+std::optional<PatchCandidate> Mutator::CandidateGenerator::next(){
+    State &st = *state_;
+    while (true){
+        // Expand groups until the best pending candidate beats every unexpanded group's bound
+        while (st.next_group < st.groups.size()
+               && st.groups[st.next_group].bound >= st.confidence_threshold
+               && (st.heap.empty() || st.heap.front().priority <= static_cast<float>(st.groups[st.next_group].bound))){
+            st.expandNextBatch();
+        }
+        if (st.heap.empty()) return std::nullopt;
+
+        std::pop_heap(st.heap.begin(), st.heap.end(), State::lowerPriority);
+        const State::CompactCandidate compact = st.heap.back();
+        st.heap.pop_back();
+        PatchCandidate p = st.materialize(compact);
+
+        // Deletions do not depend on the ingredient, and different ingredients or rules can produce
+        // the same text. The first (best) variant of an edit is yielded, later ones are dropped.
+        if (!st.emitted.insert(p.fingerprint).second) continue;
+
+        p.patch_id = "patch_" + std::to_string(st.yielded++);
+        p.diff = makeDiff(p.start_line,
+                            p.original_code,
+                            p.modified_code);
+        return p;
+    }
+}
+
+Mutator::CandidateGenerator Mutator::candidates(const std::vector<ASTNode> &ast_nodes) const {
+    auto st = std::make_unique<CandidateGenerator::State>();
+    st->num_threads = num_threads_;
+    st->confidence_threshold = confidence_threshold_;
+
+    for (auto &node : ast_nodes){
+        if (node.suspiciousness_score > 0.0){
+            st->targets.push_back(&node);
+            st->target_visible.emplace_back(node.scope_context.visible_names.begin(),
+                                            node.scope_context.visible_names.end());
+            st->target_families.push_back(typeFamily(node.inferred_type));
+            st->target_genealogy.push_back(KnowledgeBase::genealogyHash(node.genealogy_context));
+        }
+    }
 
     /**
-     * For each target (suspicious node), we iterate over all source (fix‐ingredient) nodes
-     * and apply each historical mutation rule in hist_ to generate PatchCandidate objects:
-     *
-     *   Replacement:
-     *     - Look up entries in hist_.replacement whose target_node matches t->node_type.
-     *     - Only consider source (fix ingredient) nodes s where s->node_type == t->node_type.
-     *     - Skip any multi line replacements (Only considering single-line patches for now)
-     *     - Build a diff, compute replacement similarity (genealogy × dependency × variable),
-     *       record suspiciousness and similarity scores.
-     *
-     *   Insertion:
-     *     - Look up entries in hist_.insertion matching t->node_type and s->node_type.
-     *     - Skip multi‐line insertions
-     *     - Construct the diff with orig="" and mod = s->source_text.
-     *     - Compute insertion similarity (genealogy × dependency) and record the scores
-     *
-     *   Deletion:
-     *     - Look up entries in hist_.deletion matching t->node_type and s->node_type.
-     *     - Skip multi‐line deletions.
-     *     - Construct the diff with mod="" and orig = t->source_text.
-     *     - Compute deletion similarity (genealogy × dependency), record scores.
+     * Ingredients with the same node type and (whitespace-normalized) text would all produce the same edit,
+     * so they are hash-consed into one class per (type, text). A class carries the element-wise maximum of
+     * its members' genealogy and dependency counts, which makes its similarity to a target the best any
+     * copy could reach. The variable context only depends on the text, so the first member's is used.
      */
-    for (auto *t : targets){
-        for (auto *s : ingredients){
-            // Replacement
-            for (auto &e : hist_.replacement){
-                if (e.target_node == t->node_type && s->node_type == t->node_type){
-                    auto &orig = t->source_text;
-                    auto &mod  = s->source_text;
-                    if (orig.find('\n') != std::string::npos || mod.find('\n')  != std::string::npos) continue; // skip multi-line edits
-                    if (orig == mod) continue; // skip patches with the exact same code as the original (avoid duplicates)
-                    
-                    PatchCandidate p;
-                    p.patch_id = "patch_" + std::to_string(id_counter++);
-                    p.target_node_id   = t->node_id;
-                    p.file_path = t->file_path;
-                    p.start_line = t->start_line;
-                    p.end_line = t->end_line;
-                    p.original_code = t->source_text;
-                    p.modified_code = s->source_text;
-                    p.diff = makeDiff(t->start_line,
-                                        p.original_code,
-                                        p.modified_code);
-                    p.mutation_type.mutation_category = "Replacement";
-                    p.mutation_type.target_node = t->node_type;
-                    p.mutation_type.source_node = s->node_type;
-
-                    p.suspiciousness_score = t->suspiciousness_score;
-                    p.similarity_score = computeReplacementSimilarity(
-                        s->genealogy_context, t->genealogy_context,
-                        s->dependency_context, t->dependency_context,
-                        s->variable_context, t->variable_context);
-
-                    patch_candidates.push_back(std::move(p));
-                }
-            }
+    auto merge_max = [](TypeCountMap &into, const TypeCountMap &from){
+        for (auto &kv : from){
+            int &count = into[kv.first];
+            count = std::max(count, kv.second);
+        }
+    };
+    // A name only has to be visible at the target if every copy of the ingredient needs it
+    auto intersect = [](std::vector<std::string> &into, const std::vector<std::string> &from){
+        std::erase_if(into, [&from](const std::string &name){
+            return std::find(from.begin(), from.end(), name) == from.end();
+        });
+    };
+    std::unordered_map<std::string, size_t> class_index;
+    // Building up the fix-ingredients to be ALL the nodes in the file, not just the non-suspicious nodes
+    // Since supsicious nodes are all probalistic, there will be a handful of suspicious nodes that are actually valid and not broken
+    // so it makes sense to include them in the overall pool of fix ingredients
+    for (auto &node : ast_nodes){
+        std::string text = normalizeText(node.source_text);
+        auto [it, inserted] = class_index.try_emplace(node.node_type + '\0' + text, st->classes.size());
+        if (inserted){
+            st->classes.push_back({&node, std::move(text), node.genealogy_context, node.dependency_context, {},
+                                   node.scope_context.required_locals, node.scope_context.required_members,
+                                   typeFamily(node.inferred_type)});
+            st->ingredients_by_type[node.node_type].push_back(it->second);
+        } else {
+            auto &c = st->classes[it->second];
+            merge_max(c.genealogy.type_counts, node.genealogy_context.type_counts);
+            merge_max(c.dependency.slice_counts, node.dependency_context.slice_counts);
+            intersect(c.required_locals, node.scope_context.required_locals);
+            intersect(c.required_members, node.scope_context.required_members);
+            if (c.type_family != typeFamily(node.inferred_type)) c.type_family.clear();
+        }
+        st->classes[it->second].instances.push_back(&node);
+    }
+
+    // Encode every class and target once as dense count vectors over the node types seen in this batch.
+    // Rows 0..classes-1 are the ingredient classes, the targets follow.
+    for (auto &c : st->classes) st->vocabulary.add(c.genealogy, c.dependency, c.representative->variable_context);
+    for (auto *t : st->targets) st->vocabulary.add(t->genealogy_context, t->dependency_context, t->variable_context);
+    st->dense.emplace(st->vocabulary);
+    for (auto &c : st->classes) st->dense->add(c.genealogy, c.dependency, c.representative->variable_context);
+    for (auto *t : st->targets) st->dense->add(t->genealogy_context, t->dependency_context, t->variable_context);
+
+    size_t known_groups = 0;
+    for (size_t target_idx = 0; target_idx < st->targets.size(); ++target_idx){
+        const ASTNode *t = st->targets[target_idx];
+        if (t->source_text.find('\n') != std::string::npos) continue; // skip multi-line edits
+        auto rules = rules_by_target_.find(t->node_type);
+        if (rules == rules_by_target_.end()) continue;
 
-            // Insertion
-            for (auto &e : hist_.insertion){
-                if (e.target_node == t->node_type && e.source_node == s->node_type){
-
-                    auto &orig = t->source_text;
-                    auto &mod  = s->source_text;
-                    if (orig.find('\n') != std::string::npos || mod.find('\n')  != std::string::npos) continue;
-
-                    PatchCandidate p;
-                    p.patch_id = "patch_" + std::to_string(id_counter++);
-                    p.target_node_id   = t->node_id;
-                    p.file_path = t->file_path;
-                    p.start_line = t->start_line;
-                    p.end_line = t->start_line;
-                    p.original_code = "";
-                    p.modified_code = s->source_text;
-                    p.diff = makeDiff(t->start_line,
-                                        p.original_code,
-                                        p.modified_code);
-
-                    p.mutation_type.mutation_category = "Insertion";
-                    p.mutation_type.target_node = t->node_type;
-                    p.mutation_type.source_node = s->node_type;
-
-                    p.suspiciousness_score = t->suspiciousness_score;
-                    p.similarity_score = computeInsertionSimilarity(
-                        s->genealogy_context, t->genealogy_context,
-                        s->dependency_context, t->dependency_context);
-
-                    patch_candidates.push_back(std::move(p));
-                }
+        for (auto &rule : rules->second){
+            if (rule.kind != RuleKind::Operator && !st->ingredients_by_type.count(rule.source_node)) continue;
+            double max_similarity = 1.0;
+            if (rule.kind == RuleKind::Replacement){
+                max_similarity = std::max<double>(1.0, t->variable_context.var_counts.size());
             }
+            // fix shapes that worked before go first
+            double boost = 1.0;
+            if (knowledge_){
+                boost = knowledge_->boost(KnowledgeBase::key(t->node_type, st->target_genealogy[target_idx],
+                                                             CandidateGenerator::State::categoryName(rule.kind),
+                                                             rule.source_node));
+                known_groups += boost > 1.0;
+            }
+            st->groups.push_back({target_idx, &rule, t->suspiciousness_score * rule.freq * max_similarity * boost,
+                                  boost});
+        }
+    }
+    std::stable_sort(st->groups.begin(), st->groups.end(), [](const auto &a, const auto &b){
+        return a.bound > b.bound;
+    });
+    st->pair_cache.resize(st->targets.size());
+    st->operator_rewrites.resize(st->groups.size());
 
-            // Deletion
-            for (auto &e : hist_.deletion){
-                if (e.target_node == t->node_type && e.source_node == s->node_type){
-                    auto &orig = t->source_text;
-                    auto &mod  = s->source_text;
-                    if (orig.find('\n') != std::string::npos || mod.find('\n')  != std::string::npos) continue;
-
-                    PatchCandidate p;
-                    p.patch_id = "patch_" + std::to_string(id_counter++);
-                    p.target_node_id   = t->node_id;
-                    p.file_path = t->file_path;
-                    p.start_line = t->start_line;
-                    p.end_line = t->end_line;
-                    p.original_code = t->source_text;
-                    p.modified_code = "";
-                    p.diff = makeDiff(t->start_line,
-                                        p.original_code,
-                                        p.modified_code);
-
-                    p.mutation_type.mutation_category = "Deletion";
-                    p.mutation_type.target_node = t->node_type;
-                    p.mutation_type.source_node = s->node_type;
-
-                    p.suspiciousness_score = t->suspiciousness_score;
-                    p.similarity_score = computeDeletionSimilarity(
-                        s->genealogy_context, t->genealogy_context,
-                        s->dependency_context, t->dependency_context);
-
-                    patch_candidates.push_back(std::move(p));
-                }
+    // Project-wide pools: index the large buckets so a target only scores its top-M neighbours
+    st->retrieval_top_m = retrieval_top_m_;
+    if (retrieval_top_m_ > 0){
+        for (auto &[type, bucket] : st->ingredients_by_type){
+            if (bucket.size() <= retrieval_top_m_) continue;
+            IngredientIndex &index = st->indexes[type];
+            for (size_t idx : bucket){
+                const auto &c = st->classes[idx];
+                index.add(idx, IngredientIndex::signature(IngredientIndex::tokens(
+                    c.genealogy, c.dependency, c.representative->variable_context)));
             }
         }
+        for (auto *t : st->targets){
+            st->target_signatures.push_back(IngredientIndex::signature(IngredientIndex::tokens(
+                t->genealogy_context, t->dependency_context, t->variable_context)));
+        }
+        st->retrieved.resize(st->targets.size());
+        LOG_COMPONENT_INFO("mutator", "LSH retrieval: top {} ingredients per target, {} buckets indexed",
+                            retrieval_top_m_, st->indexes.size());
+    }
+
+    LOG_COMPONENT_INFO("mutator", "{} ingredients collapsed into {} equivalence classes, {} (target, rule) groups",
+                        ast_nodes.size(), st->classes.size(), st->groups.size());
+    if (knowledge_){
+        LOG_COMPONENT_INFO("mutator", "{} groups match fixes from the knowledge base", known_groups);
+    }
+    return CandidateGenerator(std::move(st));
+}
+
+std::vector<PatchCandidate> Mutator::generatePatches(
+    const std::vector<ASTNode> &ast_nodes,
+    const std::vector<std::string> &source_files){
+    LOG_COMPONENT_INFO("mutator", "input: {} AST nodes, {} source files",
+                        ast_nodes.size(), source_files.size());
+
+    // Helpful for debugging, every node is an ingredient and the suspicious ones are also targets (--trace mutator)
+    if (Trace::enabled(Trace::Stage::Mutator)){
+        for (auto &node : ast_nodes){
+            Trace::emit(Trace::Stage::Mutator, node.suspiciousness_score > 0.0 ? "target" : "ingredient", node);
+        }
+    }
+
+    auto generator = candidates(ast_nodes);
+    std::vector<PatchCandidate> patch_candidates;
+    while (max_patches_ == 0 || patch_candidates.size() < max_patches_){
+        auto candidate = generator.next();
+        if (!candidate) break;
+        patch_candidates.push_back(std::move(*candidate));
+    }
+    if (Trace::enabled(Trace::Stage::Mutator)){
+        for (auto &p : patch_candidates) Trace::emit(Trace::Stage::Mutator, "candidate", p);
     }
-    dumpPatchCandidates(patch_candidates); 
 
-    LOG_COMPONENT_INFO("mutator", "generated {} patch candidates", patch_candidates.size());
+    LOG_COMPONENT_INFO("mutator", "generated {} patch candidates, expanded {}/{} (target, rule) groups, {} rejected before scoring",
+                        patch_candidates.size(), generator.expandedGroups(), generator.totalGroups(),
+                        generator.rejectedCandidates());
     return patch_candidates;
 }
 
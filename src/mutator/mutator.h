@@ -1,12 +1,16 @@
 #pragma once
 
 #include "../core/contracts.h"
+#include <memory>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <cstdio>
+#include <cstdint>
 #include "context.h"
-#include "freq_loader.h"
-#include "utils.h" 
+#include "../core/frequency_model.h"
+#include "../core/knowledge_base.h"
 
 namespace apr_system {
 
@@ -17,11 +21,51 @@ namespace apr_system {
  * against available ingredients and historical mutation frequencies.
  */
 class Mutator : public IMutator {
-  HistoricalFreqs hist_;
+  /**
+   * @brief mutation operator a historical rule belongs to
+   */
+  enum class RuleKind { Replacement, Insertion, Deletion, Operator };
+
+  /**
+   * @brief a historical rule applicable to targets of one node type
+   */
+  struct Rule {
+    RuleKind kind;
+    // node type of the ingredients the rule draws from, for Operator rules
+    // the operator class (see operatorMutations)
+    std::string source_node;
+    // historical frequency, the last entry wins like in the prioritizer
+    double freq;
+  };
+
+  // historical frequencies, shared with the prioritizer
+  std::shared_ptr<const FrequencyModel> frequencies_;
+  // target node type -> distinct rules, built once from frequencies_
+  std::unordered_map<std::string, std::vector<Rule>> rules_by_target_;
+  // worker threads for generatePatches, 0 = hardware concurrency
+  size_t num_threads_ = 0;
+  // generatePatches stops after this many candidates, 0 = no limit
+  size_t max_patches_ = 0;
+  // candidates whose priority is below this are never constructed
+  double confidence_threshold_ = 0.0;
+  // ingredients retrieved per target and rule through the LSH index, 0 = all
+  size_t retrieval_top_m_ = 0;
+  // fixes that worked in earlier runs, optional
+  std::shared_ptr<const KnowledgeBase> knowledge_;
+
+  /**
+   * @brief index frequencies_ by target node type, dropping duplicate rules
+   */
+  void buildRuleTable();
+
 public:
+  class CandidateGenerator;
+
   explicit Mutator(const std::string &frequency_json_path)
-      : hist_( loadHistoricalFrequencies(frequency_json_path) ) {}
-  Mutator() : hist_() {}
+      : Mutator(FrequencyModel::load(frequency_json_path)) {}
+  explicit Mutator(std::shared_ptr<const FrequencyModel> frequencies)
+      : frequencies_(std::move(frequencies)) { buildRuleTable(); }
+  Mutator() = default;
   ~Mutator() = default;
 
   /**
@@ -29,7 +73,9 @@ public:
    *
    * For each AST node flagged as suspicious, considers all non‐suspicious
    * ingredients, applies historical rules, computes diffs, similarity
-   * and priority scores, and returns a vector of PatchCandidate.
+   * and priority scores, and returns a vector of PatchCandidate. Drains
+   * candidates() up to the max_patches limit, so the result is ordered by
+   * descending priority.
    *
    * @param ast_nodes AST nodes extracted by the parser
    * @param source_files the list of source file paths for context
@@ -39,9 +85,143 @@ public:
   generatePatches(const std::vector<ASTNode> &ast_nodes,
                   const std::vector<std::string> &source_files) override;
 
+  /**
+   * @brief lazily enumerate candidates in descending priority
+   *
+   * priority is similarity × suspiciousness × rule frequency, the score the
+   * prioritizer assigns. (target, rule) groups are only expanded once their
+   * upper bound can still beat the best pending candidate, so taking the
+   * first K candidates only pays for the groups that can contribute to them.
+   *
+   * @param ast_nodes AST nodes extracted by the parser. the nodes and this
+   * mutator must outlive the generator
+   * @return generator over the candidates
+   */
+  CandidateGenerator candidates(const std::vector<ASTNode> &ast_nodes) const;
+
+  /**
+   * @brief cap the number of candidates generatePatches returns
+   * @param max_patches limit, 0 = no limit
+   */
+  void setMaxPatches(size_t max_patches) { max_patches_ = max_patches; }
+
+  /**
+   * @brief drop candidates whose priority is below a threshold
+   * @param threshold minimum priority (similarity × suspiciousness × freq)
+   */
+  void setConfidenceThreshold(double threshold) { confidence_threshold_ = threshold; }
+
+  /**
+   * @brief limit each (target, rule) pair to the most context-similar
+   * ingredients
+   *
+   * buckets with more than top_m ingredients get a MinHash/LSH index (see
+   * IngredientIndex) and only the top_m retrieved ingredients are scored
+   * exactly. deletion rules favour dissimilar ingredients and score the
+   * nearest top_m / 2 plus an even spread of the bucket instead.
+   *
+   * @param top_m ingredients per target and rule, 0 = exhaustive (default)
+   */
+  void setRetrievalTopM(size_t top_m) { retrieval_top_m_ = top_m; }
+
+  /**
+   * @brief try fix shapes that worked in earlier runs first
+   *
+   * the priority of every (target, rule) group whose shape is in the
+   * knowledge base is multiplied by KnowledgeBase::boost, so those groups
+   * are expanded and yielded ahead of equally scored ones.
+   *
+   * @param knowledge knowledge base, nullptr to disable
+   */
+  void setKnowledgeBase(std::shared_ptr<const KnowledgeBase> knowledge) { knowledge_ = std::move(knowledge); }
+
+  /**
+   * @brief set the number of threads patch generation uses
+   * @param num_threads worker count, 0 = hardware concurrency. the generated
+   * candidates do not depend on it
+   */
+  void setThreadCount(size_t num_threads) { num_threads_ = num_threads; }
+
+  /**
+   * @brief canonical form of a code snippet for equality checks
+   *
+   * collapses every whitespace run to a single space and trims both ends, so
+   * snippets that differ only in formatting compare equal. string and char
+   * literals (raw strings included) are kept verbatim.
+   */
+  static std::string normalizeText(const std::string &text);
+
+  /**
+   * @brief coarse compatibility family of a declared type
+   *
+   * arithmetic types (including bool and char) are "numeric", std::string,
+   * string_view and char pointers are "string", other pointers are
+   * "pointer" and standard library classes are named after their template
+   * ("std::vector"). cv-qualifiers and references are ignored. anything
+   * else, e.g. user types and typedefs, is unknown and returns "".
+   * replacing a value by one of a different known family cannot compile.
+   */
+  static std::string typeFamily(const std::string &type);
+
+  /**
+   * @brief canonical fingerprint of an edit
+   * @param file_path file the edit applies to
+   * @param start_byte first byte replaced
+   * @param end_byte one past the last byte replaced (equal to start_byte for
+   * an insertion)
+   * @param new_text text written in place of the range
+   * @return 64-bit hash, equal for edits that produce the same file
+   */
+  static std::uint64_t fingerprint(const std::string &file_path, int start_byte,
+                                   int end_byte, const std::string &new_text);
+
   static std::string makeDiff(int startLine,
                             const std::string &orig,
                             const std::string &mod);
 };
 
+/**
+ * @brief best-first enumeration of patch candidates, see Mutator::candidates
+ *
+ * identical edits (equal fingerprints) are yielded once, at the priority of
+ * their best variant. the sequence does not depend on the thread count.
+ */
+class Mutator::CandidateGenerator {
+public:
+  CandidateGenerator(CandidateGenerator &&) noexcept;
+  CandidateGenerator &operator=(CandidateGenerator &&) noexcept;
+  ~CandidateGenerator();
+
+  /**
+   * @brief next candidate in descending priority
+   * @return the candidate, or nullopt once every group above the confidence
+   * threshold is exhausted
+   */
+  std::optional<PatchCandidate> next();
+
+  /**
+   * @brief (target, rule) groups expanded so far and in total
+   */
+  size_t expandedGroups() const;
+  size_t totalGroups() const;
+
+  /**
+   * @brief ingredients dropped before scoring because they cannot compile at
+   * the target (names not in scope)
+   */
+  size_t rejectedCandidates() const;
+
+  /**
+   * @brief ingredients the expanded groups looked at, scored or rejected
+   */
+  size_t consideredIngredients() const;
+
+private:
+  friend class Mutator;
+  struct State;
+  explicit CandidateGenerator(std::unique_ptr<State> state);
+
+  std::unique_ptr<State> state_;
+};
+
 } // namespace apr_system
@@ -0,0 +1,250 @@
+#include "operator_mutations.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace apr_system {
+
+namespace {
+
+struct OperatorSwap {
+    const char *from;
+    const char *operator_class;
+    const char *to;
+};
+
+// every swap the engine knows, an operator can appear in several families
+const OperatorSwap kSwaps[] = {
+    {"<", "boundary", "<="}, {"<=", "boundary", "<"}, {">", "boundary", ">="}, {">=", "boundary", ">"},
+    {"<", "relational", ">"}, {"<=", "relational", ">="}, {">", "relational", "<"}, {">=", "relational", "<="},
+    {"==", "relational", "!="}, {"!=", "relational", "=="},
+    {"+", "arithmetic", "-"}, {"-", "arithmetic", "+"}, {"*", "arithmetic", "/"}, {"/", "arithmetic", "*"},
+    {"&&", "logical", "||"}, {"||", "logical", "&&"},
+};
+
+// binary operators by precedence level, a larger level binds looser
+struct Precedence {
+    const char *op;
+    int level;
+};
+const Precedence kPrecedence[] = {
+    {"*", 5}, {"/", 5}, {"%", 5}, {"+", 6}, {"-", 6}, {"<<", 7}, {">>", 7}, {"<=>", 8},
+    {"<", 9}, {"<=", 9}, {">", 9}, {">=", 9}, {"==", 10}, {"!=", 10},
+    {"&", 11}, {"^", 12}, {"|", 13}, {"&&", 14}, {"||", 15},
+};
+const int kShiftLevel = 7;
+
+// multi-character punctuators, longest first so the scanner takes the maximal munch
+const char *kPunctuators[] = {
+    "<<=", ">>=", "<=>", "->*", "...", "->", "::", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||",
+    "++", "--", "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", ".*",
+};
+
+struct Token {
+    size_t pos;
+    size_t len;
+    bool punctuator;
+};
+
+bool is_word_char(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// Helper, split an expression into operands (identifiers, numbers, literals) and punctuators
+std::vector<Token> tokenize(std::string_view text) {
+    std::vector<Token> tokens;
+    size_t i = 0;
+    while (i < text.size()) {
+        const char c = text[i];
+        const size_t start = i;
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+            continue;
+        }
+        if (c == '"' || c == '\'') {
+            for (++i; i < text.size() && text[i] != c; ++i) {
+                if (text[i] == '\\') ++i;
+            }
+            i = std::min(i + 1, text.size());
+            tokens.push_back({start, i - start, false});
+        } else if (is_word_char(c)) {
+            const bool number = std::isdigit(static_cast<unsigned char>(c));
+            for (++i; i < text.size(); ++i) {
+                const char d = text[i];
+                if (is_word_char(d) || (number && (d == '.' || d == '\''))) continue;
+                // exponent sign of a floating literal, 1e-5
+                if (number && (d == '+' || d == '-') && std::strchr("eEpP", text[i - 1])) continue;
+                break;
+            }
+            tokens.push_back({start, i - start, false});
+        } else {
+            size_t len = 1;
+            for (const char *p : kPunctuators) {
+                if (text.substr(i, std::strlen(p)) == p) {
+                    len = std::strlen(p);
+                    break;
+                }
+            }
+            i += len;
+            tokens.push_back({start, len, true});
+        }
+    }
+    return tokens;
+}
+
+int precedence_of(std::string_view op) {
+    for (const auto &p : kPrecedence) {
+        if (op == p.op) return p.level;
+    }
+    return 0;
+}
+
+struct RootOperator {
+    size_t pos = std::string::npos;
+    size_t len = 0;
+    int level = 0;
+};
+
+// Helper, the operator a binary expression splits at: the loosest binding one outside
+// brackets, rightmost among equals since all of them associate to the left
+RootOperator root_operator(std::string_view text) {
+    RootOperator root;
+    int depth = 0;
+    // depths at which a static_cast<T> style bracket was opened
+    std::vector<int> angles;
+    bool after_operand = false;
+    std::string_view previous;
+    for (const Token &token : tokenize(text)) {
+        const std::string_view s = text.substr(token.pos, token.len);
+        if (!token.punctuator) {
+            after_operand = true;
+        } else if (s == "<" && previous.ends_with("_cast")) {
+            angles.push_back(depth++);
+            after_operand = false;
+        } else if (s == ">" && !angles.empty() && angles.back() == depth - 1) {
+            angles.pop_back();
+            --depth;
+            after_operand = false;
+        } else if (s == "(" || s == "[" || s == "{") {
+            ++depth;
+            after_operand = false;
+        } else if (s == ")" || s == "]" || s == "}") {
+            --depth;
+            after_operand = true;
+        } else if (depth == 0 && (s == "?" || s == "," || s == ";" ||
+                                  (s.back() == '=' && precedence_of(s) == 0))) {
+            return {}; // assignment, conditional or comma, not a plain binary expression
+        } else {
+            const int level = precedence_of(s);
+            // a prefix +, -, * or & follows another operator
+            if (depth == 0 && level > 0 && after_operand && level >= root.level) {
+                root = {token.pos, token.len, level};
+            }
+            if (s != "++" && s != "--") after_operand = false;
+        }
+        previous = s;
+    }
+    return root;
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) text.remove_prefix(1);
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) text.remove_suffix(1);
+    return text;
+}
+
+// Helper, whether the text is one bracketed group, (a) but not (a) && (b)
+bool fully_parenthesized(std::string_view text) {
+    if (text.size() < 2 || text.front() != '(' || text.back() != ')') return false;
+    int depth = 0;
+    const auto tokens = tokenize(text);
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const std::string_view s = text.substr(tokens[i].pos, tokens[i].len);
+        if (!tokens[i].punctuator) continue;
+        if (s == "(") ++depth;
+        if (s == ")" && --depth == 0 && i + 1 != tokens.size()) return false;
+    }
+    return depth == 0;
+}
+
+// Helper, digits and suffix of a decimal integer literal
+bool split_integer_literal(std::string_view text, std::string_view &digits, std::string_view &suffix) {
+    size_t end = 0;
+    while (end < text.size() && std::isdigit(static_cast<unsigned char>(text[end]))) ++end;
+    digits = text.substr(0, end);
+    suffix = text.substr(end);
+    if (digits.empty() || digits.size() > 18) return false;
+    if (digits.size() > 1 && digits.front() == '0') return false; // octal
+    for (char c : suffix) {
+        if (!std::strchr("uUlL", c)) return false;
+    }
+    return true;
+}
+
+void binary_mutations(const std::string &text, std::vector<OperatorMutation> &out) {
+    const RootOperator root = root_operator(text);
+    if (root.pos == std::string::npos) return;
+    const std::string_view op = std::string_view(text).substr(root.pos, root.len);
+
+    for (const auto &swap : kSwaps) {
+        if (op != swap.from) continue;
+        out.push_back({swap.operator_class, text.substr(0, root.pos) + swap.to + text.substr(root.pos + root.len)});
+    }
+
+    if (op == "<" || op == "<=" || op == ">" || op == ">=") {
+        const std::string_view right = trim(std::string_view(text).substr(root.pos + root.len));
+        std::string_view digits, suffix;
+        if (right.empty() || split_integer_literal(right, digits, suffix)) return; // the literal's own mutations cover it
+        const std::string left = text.substr(0, text.size() - right.size());
+        std::string operand(right);
+        if (root_operator(right).level >= kShiftLevel) operand = "(" + operand + ")";
+        out.push_back({"bound", left + operand + " + 1"});
+        out.push_back({"bound", left + operand + " - 1"});
+    }
+}
+
+void literal_mutations(const std::string &text, std::vector<OperatorMutation> &out) {
+    std::string_view digits, suffix;
+    if (!split_integer_literal(text, digits, suffix)) return;
+    const unsigned long long value = std::stoull(std::string(digits));
+    out.push_back({"literal", std::to_string(value + 1) + std::string(suffix)});
+    if (value > 0) out.push_back({"literal", std::to_string(value - 1) + std::string(suffix)});
+}
+
+void negation_mutations(const std::string &text, std::vector<OperatorMutation> &out) {
+    const std::string_view clause = trim(text);
+    if (!fully_parenthesized(clause)) return;
+    const std::string_view inner = trim(clause.substr(1, clause.size() - 2));
+    if (inner.empty()) return;
+    for (const Token &token : tokenize(inner)) {
+        const std::string_view s = inner.substr(token.pos, token.len);
+        // init statements and declarations, if (int n = f(); n > 0)
+        if (token.punctuator && (s == ";" || s == "=")) return;
+    }
+
+    if (inner.front() == '!' && root_operator(inner.substr(1)).pos == std::string::npos) {
+        std::string_view operand = trim(inner.substr(1));
+        if (fully_parenthesized(operand)) operand = trim(operand.substr(1, operand.size() - 2));
+        out.push_back({"negation", "(" + std::string(operand) + ")"});
+    } else {
+        out.push_back({"negation", "(!(" + std::string(inner) + "))"});
+    }
+}
+
+} // namespace
+
+std::vector<OperatorMutation> operatorMutations(const std::string &node_type, const std::string &source_text) {
+    std::vector<OperatorMutation> mutations;
+    if (node_type == "binary_expression") {
+        binary_mutations(source_text, mutations);
+    } else if (node_type == "number_literal") {
+        literal_mutations(source_text, mutations);
+    } else if (node_type == "condition_clause") {
+        negation_mutations(source_text, mutations);
+    }
+    return mutations;
+}
+
+} // namespace apr_system
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace apr_system {
+
+/**
+ * @brief an ingredient-free rewrite of a target node
+ */
+struct OperatorMutation {
+  // rule family the rewrite belongs to, matched against the "source" of
+  // the Operator entries in the frequency file
+  std::string operator_class;
+  // full text that replaces the target
+  std::string text;
+};
+
+/**
+ * @brief table-driven operator mutations of one target node
+ *
+ * works on the node text alone, no ingredient is needed:
+ *  - binary_expression: the top-level operator is swapped within its
+ *    family ("boundary" for </<= and >/>= flips, "relational", "arithmetic",
+ *    "logical"), and the right operand of a comparison is moved by one
+ *    ("bound")
+ *  - number_literal: decimal integers are moved by one ("literal")
+ *  - condition_clause: the condition is negated ("negation")
+ *
+ * @param node_type tree-sitter type of the target
+ * @param source_text text of the target
+ * @return the rewrites, in table order
+ */
+std::vector<OperatorMutation> operatorMutations(const std::string &node_type,
+                                                const std::string &source_text);
+
+} // namespace apr_system
@@ -0,0 +1,169 @@
+#include "similarity_kernels.h"
+#include <algorithm>
+
+#if !defined(APR_DISABLE_SIMD) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define APR_SIMD_AVX2 1
+#include <immintrin.h>
+#elif !defined(APR_DISABLE_SIMD) && defined(__ARM_NEON)
+#define APR_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace apr_system {
+
+namespace {
+
+int64_t min_sum_scalar(const int32_t *a, const int32_t *b, size_t n) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += std::min(a[i], b[i]);
+    }
+    return sum;
+}
+
+#if defined(APR_SIMD_AVX2)
+__attribute__((target("avx2")))
+int64_t min_sum_avx2(const int32_t *a, const int32_t *b, size_t n) {
+    // 64-bit accumulators, counts are never negative so widening by zero-extension is fine
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        __m256i m = _mm256_min_epi32(va, vb);
+        acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(m)));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(m, 1)));
+    }
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + min_sum_scalar(a + i, b + i, n - i);
+}
+
+bool has_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+#if defined(APR_SIMD_NEON)
+int64_t min_sum_neon(const int32_t *a, const int32_t *b, size_t n) {
+    int64x2_t acc = vdupq_n_s64(0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32x4_t m = vminq_s32(vld1q_s32(a + i), vld1q_s32(b + i));
+        acc = vpadalq_s32(acc, m);
+    }
+    return vgetq_lane_s64(acc, 0) + vgetq_lane_s64(acc, 1) + min_sum_scalar(a + i, b + i, n - i);
+}
+#endif
+
+} // namespace
+
+int64_t minSum(const int32_t *a, const int32_t *b, size_t n) {
+#if defined(APR_SIMD_AVX2)
+    if (has_avx2()) return min_sum_avx2(a, b, n);
+#elif defined(APR_SIMD_NEON)
+    return min_sum_neon(a, b, n);
+#endif
+    return min_sum_scalar(a, b, n);
+}
+
+size_t sortedIntersectionSize(const uint32_t *a, size_t a_size,
+                              const uint32_t *b, size_t b_size) {
+    // variable sets are a handful of ids, a branch-light merge beats anything wider
+    size_t i = 0, j = 0, common = 0;
+    while (i < a_size && j < b_size) {
+        const uint32_t x = a[i], y = b[j];
+        common += x == y;
+        i += x <= y;
+        j += y <= x;
+    }
+    return common;
+}
+
+void ContextVocabulary::add(const GenealogyContext &genealogy,
+                            const DependencyContext &dependency,
+                            const VariableContext &variables) {
+    for (const auto &kv : genealogy.type_counts) {
+        type_ids_.try_emplace(kv.first, static_cast<uint32_t>(type_ids_.size()));
+    }
+    for (const auto &kv : dependency.slice_counts) {
+        type_ids_.try_emplace(kv.first, static_cast<uint32_t>(type_ids_.size()));
+    }
+    for (const auto &kv : variables.var_counts) {
+        variable_ids_.try_emplace(kv.first, static_cast<uint32_t>(variable_ids_.size()));
+    }
+}
+
+int ContextVocabulary::typeId(const std::string &node_type) const {
+    auto it = type_ids_.find(node_type);
+    return it == type_ids_.end() ? -1 : static_cast<int>(it->second);
+}
+
+int ContextVocabulary::variableId(const std::string &variable_key) const {
+    auto it = variable_ids_.find(variable_key);
+    return it == variable_ids_.end() ? -1 : static_cast<int>(it->second);
+}
+
+DenseContexts::DenseContexts(const ContextVocabulary &vocabulary)
+    : vocabulary_(vocabulary),
+      stride_((vocabulary.typeCount() + 7) / 8 * 8),
+      variable_offsets_{0} {}
+
+size_t DenseContexts::add(const GenealogyContext &genealogy,
+                          const DependencyContext &dependency,
+                          const VariableContext &variables) {
+    const size_t row = genealogy_totals_.size();
+    genealogy_.resize(genealogy_.size() + stride_, 0);
+    dependency_.resize(dependency_.size() + stride_, 0);
+
+    auto encode = [this, row](const TypeCountMap &counts, std::vector<int32_t> &matrix) {
+        int64_t total = 0;
+        for (const auto &kv : counts) {
+            const int id = vocabulary_.typeId(kv.first);
+            if (id < 0) continue; // not registered, contributes nothing
+            matrix[row * stride_ + id] = kv.second;
+            total += kv.second;
+        }
+        return total;
+    };
+    genealogy_totals_.push_back(encode(genealogy.type_counts, genealogy_));
+    dependency_totals_.push_back(encode(dependency.slice_counts, dependency_));
+
+    const size_t begin = variable_ids_.size();
+    for (const auto &kv : variables.var_counts) {
+        const int id = vocabulary_.variableId(kv.first);
+        if (id >= 0) variable_ids_.push_back(static_cast<uint32_t>(id));
+    }
+    std::sort(variable_ids_.begin() + begin, variable_ids_.end());
+    variable_offsets_.push_back(static_cast<uint32_t>(variable_ids_.size()));
+    return row;
+}
+
+double DenseContexts::genealogySimilarity(size_t source, size_t target) const {
+    const int64_t denominator = genealogy_totals_[target];
+    if (denominator == 0) return 0.0;
+    const int64_t numerator = minSum(&genealogy_[source * stride_], &genealogy_[target * stride_], stride_);
+    return double(numerator) / double(denominator);
+}
+
+double DenseContexts::dependencySimilarity(size_t source, size_t target) const {
+    const int64_t denominator = dependency_totals_[target];
+    if (denominator == 0) return 1.0;
+    const int64_t numerator = minSum(&dependency_[source * stride_], &dependency_[target * stride_], stride_);
+    return double(numerator) / double(denominator);
+}
+
+double DenseContexts::variableSimilarity(size_t source, size_t target) const {
+    const uint32_t *src = variable_ids_.data() + variable_offsets_[source];
+    const size_t src_size = variable_offsets_[source + 1] - variable_offsets_[source];
+    const uint32_t *tgt = variable_ids_.data() + variable_offsets_[target];
+    const size_t tgt_size = variable_offsets_[target + 1] - variable_offsets_[target];
+
+    const size_t intersection = sortedIntersectionSize(src, src_size, tgt, tgt_size);
+    const size_t union_size = src_size + tgt_size - intersection;
+    if (union_size == 0) return 1.0;
+    return src_size * (double(intersection) / double(union_size));
+}
+
+} // namespace apr_system
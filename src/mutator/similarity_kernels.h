@@ -0,0 +1,84 @@
+#pragma once
+
+#include "../core/types.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace apr_system {
+
+/**
+ * @brief sum of element-wise minimums of two count vectors
+ *
+ * uses AVX2 (detected at runtime) on x86-64 and NEON on aarch64, with a
+ * scalar fallback. build with -DAPR_DISABLE_SIMD to force the scalar path.
+ */
+int64_t minSum(const int32_t *a, const int32_t *b, size_t n);
+
+/**
+ * @brief number of ids two sorted, duplicate-free id arrays have in common
+ */
+size_t sortedIntersectionSize(const uint32_t *a, size_t a_size,
+                              const uint32_t *b, size_t b_size);
+
+/**
+ * @brief interned symbols of a batch of contexts
+ *
+ * node types (genealogy and dependency keys) and variable keys get dense
+ * ids. all contexts of a batch have to be registered before the batch is
+ * encoded, since the vocabulary size fixes the vector width.
+ */
+class ContextVocabulary {
+public:
+  void add(const GenealogyContext &genealogy,
+           const DependencyContext &dependency,
+           const VariableContext &variables);
+
+  size_t typeCount() const { return type_ids_.size(); }
+  int typeId(const std::string &node_type) const;
+  int variableId(const std::string &variable_key) const;
+
+private:
+  std::unordered_map<std::string, uint32_t> type_ids_;
+  std::unordered_map<std::string, uint32_t> variable_ids_;
+};
+
+/**
+ * @brief contexts encoded as dense count vectors and sorted variable ids
+ *
+ * every context is one row of node type counts for genealogy and one for
+ * dependency, padded to a multiple of 8 lanes, plus a sorted array of
+ * variable ids. the similarity functions match computeGenealogySimilarity,
+ * computeDependencySimilarity and computeVariableSimilarity in context.h.
+ */
+class DenseContexts {
+public:
+  explicit DenseContexts(const ContextVocabulary &vocabulary);
+
+  /**
+   * @brief encode a context
+   * @return row index used by the similarity functions
+   */
+  size_t add(const GenealogyContext &genealogy,
+             const DependencyContext &dependency,
+             const VariableContext &variables);
+
+  double genealogySimilarity(size_t source, size_t target) const;
+  double dependencySimilarity(size_t source, size_t target) const;
+  double variableSimilarity(size_t source, size_t target) const;
+
+private:
+  const ContextVocabulary &vocabulary_;
+  size_t stride_;
+  std::vector<int32_t> genealogy_;
+  std::vector<int32_t> dependency_;
+  std::vector<int64_t> genealogy_totals_;
+  std::vector<int64_t> dependency_totals_;
+  // variables of row i are variable_ids_[variable_offsets_[i] .. variable_offsets_[i + 1])
+  std::vector<uint32_t> variable_offsets_;
+  std::vector<uint32_t> variable_ids_;
+};
+
+} // namespace apr_system
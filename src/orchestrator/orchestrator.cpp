@@ -2,6 +2,7 @@
 #include <algorithm>
 #include <filesystem>
 #include <fmt/core.h>
+#include <unordered_map>
 
 #include "orchestrator.h"
 #include "../core/logger.h"
@@ -89,7 +90,9 @@ SystemState Orchestrator::runPipeline(
 
     // step 4: patch prioritization
     LOG_COMPONENT_INFO("prioritizer", "prioritizing patches...");
-    state.prioritized_patches = prioritizer_->prioritizePatches(state.patch_candidates, mutation_freq_json);
+    // by default twice the validation budget, leaving room for candidates the validator evicts unbuilt
+    state.prioritized_patches =
+        prioritizer_->prioritizePatches(state.patch_candidates, mutation_freq_json, ranked_candidates_);
     LOG_COMPONENT_INFO("prioritizer", "patch prioritization completed - prioritized {} patches", state.prioritized_patches.size());
 
     if (state.prioritized_patches.empty()) {
@@ -97,9 +100,10 @@ SystemState Orchestrator::runPipeline(
         return state;
     }
 
-    // step 5: patch validation
+    // step 5: patch validation, the prioritizer's queue re-ranks as outcomes arrive
     LOG_COMPONENT_INFO("validator", "validating patches...");
-    state.validation_results = validator_->validatePatches(state.prioritized_patches, repo_metadata, 100);  // TODO: update this later to smaller number of patches (not sure if needed)
+    auto queue = prioritizer_->validationQueue(state.patch_candidates, state.prioritized_patches);
+    state.validation_results = validator_->validatePatches(state.patch_candidates, *queue, repo_metadata, static_cast<int>(kValidationTopK));  // TODO: update this later to smaller number of patches (not sure if needed)
     LOG_COMPONENT_INFO("validator", "patch validation completed - validated {} patches", state.validation_results.size());
 
     if (state.validation_results.empty()) {
@@ -107,6 +111,22 @@ SystemState Orchestrator::runPipeline(
         return state;
     }
 
+    // remember the fix shapes that worked, later runs try them first
+    if (knowledge_) {
+        std::unordered_map<std::string, const PatchCandidate*> by_id;
+        for (const auto& patch : state.patch_candidates) by_id[patch.patch_id] = &patch;
+        size_t recorded = 0;
+        for (const auto& result : state.validation_results) {
+            if (!result.tests_passed) continue;
+            auto it = by_id.find(result.patch_id);
+            if (it == by_id.end()) continue;
+            knowledge_->recordSuccess(KnowledgeBase::key(*it->second));
+            ++recorded;
+        }
+        LOG_COMPONENT_INFO("orchestrator", "recorded {} plausible patches in the knowledge base ({} fix shapes)",
+            recorded, knowledge_->size());
+    }
+
     // NOTE: PR creation is delegated to the GitHub App layer, the engine no longer creates PRs
 
     LOG_COMPONENT_INFO("orchestrator", "APR project pipeline completed successfully!");
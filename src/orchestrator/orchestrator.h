@@ -4,6 +4,7 @@
 #include <memory>
 
 #include "../core/contracts.h"
+#include "../core/knowledge_base.h"
 // #include "../validator/json_schema_validator.h"  // TEMPORARILY DISABLED
 
 namespace apr_system {
@@ -18,6 +19,18 @@ public:
   Orchestrator();
   ~Orchestrator() override = default;
 
+  // candidates the validator builds at most
+  static constexpr size_t kValidationTopK = 100;
+  // candidates the prioritizer ranks, twice the validation budget leaves room for the ones the
+  // validator evicts unbuilt
+  static constexpr size_t kRankedCandidates = 2 * kValidationTopK;
+  // candidates the mutator generates by default when a ranking model re-ranks them, so the validated
+  // top is not just a reordering of the mutator's top
+  static constexpr size_t kRerankedCandidatePool = 50 * kValidationTopK;
+  // candidates the mutator generates by default when the validation queue interleaves locations, so
+  // the queue has other locations to move to when the best candidates all edit one line
+  static constexpr size_t kDiverseCandidatePool = 10 * kValidationTopK;
+
   /**
    * @brief run the complete apr project pipeline
    * @param repo_metadata repository metadata
@@ -39,7 +52,22 @@ public:
                      std::unique_ptr<IPrioritizer> prioritizer,
                      std::unique_ptr<IValidator> validator) override;
 
+  /**
+   * @brief record the plausible patches of every run in a knowledge base
+   * @param knowledge knowledge base, nullptr to disable
+   */
+  void setKnowledgeBase(std::shared_ptr<KnowledgeBase> knowledge) { knowledge_ = std::move(knowledge); }
+
+  /**
+   * @brief length of the ranking the validation queue draws from
+   * @param top_k candidates the prioritizer ranks, 0 ranks every scoring
+   * candidate (default: kRankedCandidates)
+   */
+  void setRankedCandidates(size_t top_k) { ranked_candidates_ = top_k; }
+
 private:
+  std::shared_ptr<KnowledgeBase> knowledge_;
+  size_t ranked_candidates_ = kRankedCandidates;
   std::unique_ptr<ISBFL> sbfl_;
   std::unique_ptr<IParser> parser_;
   std::unique_ptr<IMutator> mutator_;
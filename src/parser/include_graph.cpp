@@ -0,0 +1,327 @@
+#include "include_graph.h"
+#include "../core/logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+namespace apr_system {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Helper, canonical form of a path used as the identity of a file in the graph
+std::string canonical_key(const fs::path &path) {
+    std::error_code ec;
+    fs::path canonical = fs::weakly_canonical(path, ec);
+    if (ec) {
+        canonical = fs::absolute(path, ec).lexically_normal();
+    }
+    return canonical.string();
+}
+
+bool is_source_extension(const fs::path &path) {
+    static const std::unordered_set<std::string> exts = {".cpp", ".cc", ".cxx", ".c++"};
+    return exts.count(path.extension().string()) > 0;
+}
+
+bool is_header_extension(const fs::path &path) {
+    static const std::unordered_set<std::string> exts = {".h", ".hpp", ".hh", ".hxx"};
+    return exts.count(path.extension().string()) > 0;
+}
+
+bool has_prefix_dir(const std::string &path, const std::string &dir) {
+    return !dir.empty() && path.size() > dir.size()
+        && path.compare(0, dir.size(), dir) == 0 && path[dir.size()] == '/';
+}
+
+// Helper, split a compile command string on whitespace, honouring simple quoting
+std::vector<std::string> split_command(const std::string &command) {
+    std::vector<std::string> args;
+    std::string current;
+    char quote = 0;
+    bool has_token = false;
+    for (char c : command) {
+        if (quote) {
+            if (c == quote) quote = 0;
+            else current += c;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+            has_token = true;
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            if (has_token) {
+                args.push_back(std::move(current));
+                current.clear();
+                has_token = false;
+            }
+        } else {
+            current += c;
+            has_token = true;
+        }
+    }
+    if (has_token) args.push_back(std::move(current));
+    return args;
+}
+
+// Helper, collect -I and -iquote directories from a compiler invocation
+std::vector<std::string> include_dirs_from_args(const std::vector<std::string> &args,
+                                                const fs::path &directory) {
+    std::vector<std::string> dirs;
+    auto add = [&](const std::string &dir) {
+        fs::path p(dir);
+        if (p.is_relative()) p = directory / p;
+        dirs.push_back(canonical_key(p));
+    };
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string &arg = args[i];
+        for (const std::string flag : {"-I", "-iquote"}) {
+            if (arg == flag && i + 1 < args.size()) {
+                add(args[++i]);
+                break;
+            }
+            if (arg.size() > flag.size() && arg.compare(0, flag.size(), flag) == 0) {
+                add(arg.substr(flag.size()));
+                break;
+            }
+        }
+    }
+    return dirs;
+}
+
+// Helper, extract (header, quoted) pairs from #include directives in a file
+std::vector<std::pair<std::string, bool>> scan_includes(const std::string &file_path) {
+    std::vector<std::pair<std::string, bool>> result;
+    std::ifstream in(file_path);
+    if (!in) return result;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t i = line.find_first_not_of(" \t");
+        if (i == std::string::npos || line[i] != '#') continue;
+        i = line.find_first_not_of(" \t", i + 1);
+        if (i == std::string::npos || line.compare(i, 7, "include") != 0) continue;
+        i = line.find_first_not_of(" \t", i + 7);
+        if (i == std::string::npos) continue;
+
+        const char open = line[i];
+        const char close = open == '"' ? '"' : (open == '<' ? '>' : 0);
+        if (!close) continue;
+        size_t end = line.find(close, i + 1);
+        if (end == std::string::npos) continue;
+        result.emplace_back(line.substr(i + 1, end - i - 1), open == '"');
+    }
+    return result;
+}
+
+} // namespace
+
+IncludeGraph IncludeGraph::discover(const std::string &project_root) {
+    const std::vector<fs::path> candidates = {
+        fs::path(project_root) / "compile_commands.json",
+        fs::path(project_root) / "build" / "compile_commands.json"
+    };
+
+    for (const auto &candidate : candidates) {
+        std::error_code ec;
+        if (!fs::exists(candidate, ec) || ec) continue;
+        try {
+            IncludeGraph graph = fromCompileCommands(candidate.string(), project_root);
+            if (!graph.files_.empty()) {
+                LOG_COMPONENT_INFO("parser", "source discovery via {}: {} translation units, {} files",
+                    candidate.string(), graph.translation_units_.size(), graph.files_.size());
+                return graph;
+            }
+        } catch (const std::exception &e) {
+            LOG_COMPONENT_WARN("parser", "ignoring {}: {}", candidate.string(), e.what());
+        }
+    }
+
+    IncludeGraph graph = fromDirectory(project_root);
+    LOG_COMPONENT_INFO("parser", "source discovery via directory scan: {} translation units, {} files",
+        graph.translation_units_.size(), graph.files_.size());
+    return graph;
+}
+
+IncludeGraph IncludeGraph::fromCompileCommands(const std::string &compile_commands_path,
+                                               const std::string &project_root) {
+    std::ifstream file(compile_commands_path);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open compilation database: " + compile_commands_path);
+    }
+    nlohmann::json db = nlohmann::json::parse(file);
+    if (!db.is_array()) {
+        throw std::runtime_error("compilation database is not a json array: " + compile_commands_path);
+    }
+
+    IncludeGraph graph;
+    graph.project_root_ = canonical_key(project_root);
+    graph.build_dir_ = canonical_key(fs::path(compile_commands_path).parent_path());
+    if (graph.build_dir_ == graph.project_root_) {
+        graph.build_dir_.clear();
+    }
+
+    for (const auto &entry : db) {
+        const fs::path directory = entry.value("directory", std::string("."));
+        fs::path tu = entry.value("file", std::string());
+        if (tu.empty()) continue;
+        if (tu.is_relative()) tu = directory / tu;
+
+        std::vector<std::string> args;
+        if (entry.contains("arguments")) {
+            args = entry["arguments"].get<std::vector<std::string>>();
+        } else {
+            args = split_command(entry.value("command", std::string()));
+        }
+
+        if (!graph.isInProject(canonical_key(tu))) continue;
+        graph.addTranslationUnit(tu.string(), include_dirs_from_args(args, directory));
+    }
+    return graph;
+}
+
+IncludeGraph IncludeGraph::fromDirectory(const std::string &project_root) {
+    IncludeGraph graph;
+    graph.project_root_ = canonical_key(project_root);
+
+    const fs::path src_dir = fs::path(project_root) / "src";
+    const fs::path include_dir = fs::path(project_root) / "include";
+    const std::vector<std::string> include_dirs = {canonical_key(include_dir), canonical_key(src_dir)};
+
+    std::vector<fs::path> sources, headers;
+    for (const auto &dir : {src_dir, include_dir}) {
+        std::error_code ec;
+        if (!fs::is_directory(dir, ec)) continue;
+        for (auto it = fs::recursive_directory_iterator(dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (!it->is_regular_file()) continue;
+            if (is_source_extension(it->path())) sources.push_back(it->path());
+            else if (is_header_extension(it->path())) headers.push_back(it->path());
+        }
+    }
+    // directory iteration order is unspecified, keep discovery deterministic
+    std::sort(sources.begin(), sources.end());
+    std::sort(headers.begin(), headers.end());
+
+    for (const auto &tu : sources) {
+        graph.addTranslationUnit(tu.string(), include_dirs);
+    }
+    // headers no translation unit includes are still repair candidates
+    for (const auto &header : headers) {
+        graph.addFile(header.string());
+    }
+    return graph;
+}
+
+void IncludeGraph::addTranslationUnit(const std::string &tu_path,
+                                      const std::vector<std::string> &include_dirs) {
+    const std::string tu_key = addFile(tu_path);
+    if (std::find(translation_units_.begin(), translation_units_.end(), tu_key) == translation_units_.end()) {
+        translation_units_.push_back(tu_key);
+    }
+
+    // each file is scanned once, the first translation unit to reach it supplies the -I dirs
+    std::vector<std::string> worklist{tu_key};
+    while (!worklist.empty()) {
+        std::string current = std::move(worklist.back());
+        worklist.pop_back();
+        if (!scanned_.insert(current).second) continue;
+
+        for (const auto &[header, quoted] : scan_includes(current)) {
+            std::string included = resolveInclude(current, header, quoted, include_dirs);
+            if (included.empty()) continue;
+
+            addFile(included);
+            includes_[current].push_back(included);
+            included_by_[included].push_back(current);
+            worklist.push_back(std::move(included));
+        }
+    }
+}
+
+std::string IncludeGraph::addFile(const std::string &path) {
+    std::string key = canonical_key(path);
+    if (display_paths_.emplace(key, fs::absolute(path).lexically_normal().string()).second) {
+        files_.push_back(key);
+    }
+    return key;
+}
+
+std::string IncludeGraph::resolveInclude(const std::string &includer, const std::string &header,
+                                         bool quoted, const std::vector<std::string> &include_dirs) const {
+    std::vector<fs::path> search;
+    if (quoted) {
+        search.push_back(fs::path(includer).parent_path());
+    }
+    for (const auto &dir : include_dirs) {
+        search.emplace_back(dir);
+    }
+
+    for (const auto &dir : search) {
+        fs::path candidate = dir / header;
+        std::error_code ec;
+        if (fs::is_regular_file(candidate, ec)) {
+            std::string key = canonical_key(candidate);
+            // system and third-party headers are never repair targets
+            return isInProject(key) ? key : std::string();
+        }
+    }
+    return {};
+}
+
+bool IncludeGraph::isInProject(const std::string &canonical_path) const {
+    return has_prefix_dir(canonical_path, project_root_);
+}
+
+bool IncludeGraph::isRepairable(const std::string &canonical_path) const {
+    if (!isInProject(canonical_path) || has_prefix_dir(canonical_path, build_dir_)) {
+        return false;
+    }
+    const fs::path relative = fs::path(canonical_path).lexically_relative(project_root_);
+    for (const auto &component : relative) {
+        const std::string name = component.string();
+        if (name == "test" || name == "tests" || name == "CMakeFiles") {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> IncludeGraph::sourceFiles() const {
+    std::vector<std::string> result;
+    result.reserve(files_.size());
+    for (const auto &key : files_) {
+        if (isRepairable(key)) {
+            result.push_back(display_paths_.at(key));
+        }
+    }
+    return result;
+}
+
+std::vector<std::string>
+IncludeGraph::dependentTranslationUnits(const std::string &file_path) const {
+    const std::unordered_set<std::string> tus(translation_units_.begin(), translation_units_.end());
+    std::unordered_set<std::string> visited;
+    std::vector<std::string> worklist{canonical_key(file_path)};
+    std::vector<std::string> result;
+
+    while (!worklist.empty()) {
+        std::string current = std::move(worklist.back());
+        worklist.pop_back();
+        if (!visited.insert(current).second) continue;
+
+        if (tus.count(current)) {
+            auto it = display_paths_.find(current);
+            result.push_back(it != display_paths_.end() ? it->second : current);
+        }
+        auto parents = included_by_.find(current);
+        if (parents != included_by_.end()) {
+            worklist.insert(worklist.end(), parents->second.begin(), parents->second.end());
+        }
+    }
+    return result;
+}
+
+} // namespace apr_system
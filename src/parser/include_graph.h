@@ -0,0 +1,117 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace apr_system {
+
+/**
+ * @brief include graph of a project under repair
+ *
+ * built from compile_commands.json when the project exports one, otherwise
+ * from a recursive scan of <project>/src and <project>/include. every file
+ * (translation unit or header) appears exactly once no matter how many
+ * translation units include it, so the parser never parses a shared header
+ * twice. the reverse edges map an edited file back to the translation units
+ * that need rebuilding.
+ */
+class IncludeGraph {
+public:
+  IncludeGraph() = default;
+  ~IncludeGraph() = default;
+
+  /**
+   * @brief build the graph for a project directory
+   *
+   * looks for compile_commands.json in <project> and <project>/build and
+   * falls back to a directory scan if none is found or it cannot be read.
+   *
+   * @param project_root root directory of the buggy program
+   * @return include graph of the project
+   */
+  static IncludeGraph discover(const std::string &project_root);
+
+  /**
+   * @brief build the graph from a compilation database
+   * @param compile_commands_path path to compile_commands.json
+   * @param project_root files outside this directory are ignored
+   * @return include graph of the project
+   * @throws std::runtime_error if the database cannot be read
+   */
+  static IncludeGraph fromCompileCommands(const std::string &compile_commands_path,
+                                          const std::string &project_root);
+
+  /**
+   * @brief build the graph from a scan of <project>/src and <project>/include
+   * @param project_root root directory of the buggy program
+   * @return include graph of the project
+   */
+  static IncludeGraph fromDirectory(const std::string &project_root);
+
+  /**
+   * @brief files that are candidates for repair, each listed exactly once
+   *
+   * translation units and the project headers they reach, excluding test
+   * sources and anything under the build directory.
+   *
+   * @return deduplicated source and header paths in discovery order
+   */
+  std::vector<std::string> sourceFiles() const;
+
+  /**
+   * @brief translation units that (transitively) include a file
+   * @param file_path edited source or header
+   * @return translation units to rebuild, including file_path itself if it
+   * is a translation unit
+   */
+  std::vector<std::string>
+  dependentTranslationUnits(const std::string &file_path) const;
+
+  /**
+   * @brief all translation units known to the graph
+   */
+  const std::vector<std::string> &translationUnits() const {
+    return translation_units_;
+  }
+
+private:
+  /**
+   * @brief add a translation unit and walk its includes
+   * @param tu_path absolute path of the translation unit
+   * @param include_dirs -I / -iquote directories for this translation unit
+   */
+  void addTranslationUnit(const std::string &tu_path,
+                          const std::vector<std::string> &include_dirs);
+
+  /**
+   * @brief register a file once, returning its canonical key
+   */
+  std::string addFile(const std::string &path);
+
+  /**
+   * @brief resolve an include directive against the includer and -I dirs
+   * @return canonical key of the included file, empty if not in the project
+   */
+  std::string resolveInclude(const std::string &includer,
+                             const std::string &header, bool quoted,
+                             const std::vector<std::string> &include_dirs) const;
+
+  bool isInProject(const std::string &canonical_path) const;
+  bool isRepairable(const std::string &canonical_path) const;
+
+  std::string project_root_;
+  std::string build_dir_;
+  // canonical key -> path as reported to callers
+  std::unordered_map<std::string, std::string> display_paths_;
+  // canonical keys in discovery order
+  std::vector<std::string> files_;
+  std::vector<std::string> translation_units_;
+  std::unordered_set<std::string> scanned_;
+  // includer -> included files and the reverse edges
+  std::unordered_map<std::string, std::vector<std::string>> includes_;
+  std::unordered_map<std::string, std::vector<std::string>> included_by_;
+};
+
+} // namespace apr_system
@@ -1,13 +1,18 @@
 #include "parser.h"
 #include "../core/logger.h"
+#include "../core/trace.h"
 
 #include <fstream>
 #include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
 #include <stdexcept>
 #include <tree_sitter/api.h>
 #include "../mutator/context.h"
+#include "scope_tree.h"
 #include <functional>
 #include <iostream>
+#include <regex>
 
 extern "C" const TSLanguage *tree_sitter_cpp();
 
@@ -23,6 +28,13 @@ std::string read_file(const std::string &filename) {
     return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
 }
 
+// Helper, canonical spelling of a path so duplicates can be detected
+std::string canonical_path(const std::string &path) {
+    std::error_code ec;
+    auto canonical = std::filesystem::weakly_canonical(path, ec);
+    return ec ? path : canonical.string();
+}
+
 // Helper, convert line number to byte position in source code
 int get_byte_position_for_line(const std::string &source_content, int target_line) {
     int byte_pos = 0;
@@ -47,10 +59,19 @@ int get_byte_position_for_line(const std::string &source_content, int target_lin
     return -1;  // Should not happen
 }
 
+// Which cached contexts of a node survive an incremental reparse
+struct ContextReuse {
+    const ASTNode *cached = nullptr;
+    bool genealogy = false;
+    bool variable = false;
+    bool dependency = false;
+};
+
 // Helper, create an ASTNode from a Tree-sitter syntax tree node with SBFL metadata
 ASTNode create_ast_node(TSNode ast_Node, TSNode root_node, const std::string &source_content, 
                        int &unique_node_counter, const std::string& file_path,
-                       double suspiciousness_score = 0.0, const std::string& sbfl_reason = "") {
+                       double suspiciousness_score = 0.0, const std::string& sbfl_reason = "",
+                       const ContextReuse &reuse = {}, ScopeContext scope_context = {}) {
     // Get where this syntax element starts and ends in the file (byte positions)
     uint32_t byte_start_pos = ts_node_start_byte(ast_Node);
     uint32_t byte_end_pos = ts_node_end_byte(ast_Node);
@@ -73,6 +94,8 @@ ASTNode create_ast_node(TSNode ast_Node, TSNode root_node, const std::string &so
     parsed_AST_node.end_line = line_column_end.row + 1;
     parsed_AST_node.start_column = line_column_start.column + 1;
     parsed_AST_node.end_column = line_column_end.column + 1;
+    parsed_AST_node.start_byte = static_cast<int>(byte_start_pos);
+    parsed_AST_node.end_byte = static_cast<int>(byte_end_pos);
     parsed_AST_node.file_path = file_path;
     parsed_AST_node.source_text = source_code;
     parsed_AST_node.child_node_ids = {}; // Empty for now
@@ -81,9 +104,14 @@ ASTNode create_ast_node(TSNode ast_Node, TSNode root_node, const std::string &so
     parsed_AST_node.suspiciousness_score = suspiciousness_score;
     parsed_AST_node.sbfl_reason = sbfl_reason;
 
-    parsed_AST_node.genealogy_context = extractGenealogyContext(ast_Node);
-    parsed_AST_node.variable_context = extractVariableContext(ast_Node, source_content);
-    parsed_AST_node.dependency_context = extractDependencyContext(ast_Node, root_node, source_content);
+    // Contexts are the expensive part, take them from the previous round when the edit cannot have changed them
+    parsed_AST_node.genealogy_context = reuse.genealogy
+        ? reuse.cached->genealogy_context : extractGenealogyContext(ast_Node);
+    parsed_AST_node.variable_context = reuse.variable
+        ? reuse.cached->variable_context : extractVariableContext(ast_Node, source_content);
+    parsed_AST_node.dependency_context = reuse.dependency
+        ? reuse.cached->dependency_context : extractDependencyContext(ast_Node, root_node, source_content);
+    parsed_AST_node.scope_context = std::move(scope_context);
 
     
     return parsed_AST_node;
@@ -96,70 +124,68 @@ bool correct_pos(TSNode ast_Node, uint32_t sus_byte_pos) {
     return (node_start_byte <= sus_byte_pos && sus_byte_pos <= node_end_byte);
 }
 
-// Helper, parse a single source file into a syntax tree using Tree-sitter
-TSTree* parse_file_into_AST(const std::string& file_path, const std::string& source_content) {
-    // Create a new Tree-sitter parser
-    TSParser *parser = ts_parser_new();
-    
-    // Tell the parser we're parsing C++ code
-    ts_parser_set_language(parser, tree_sitter_cpp());
-    
-    // Parse the source code into a syntax tree
-    TSTree *AST = ts_parser_parse_string(parser, nullptr, 
-                                                source_content.c_str(), 
-                                                source_content.size());
-    
-    // Clean up the parser (we only need the tree)
-    ts_parser_delete(parser);
-    
-    if (!AST) {
-        LOG_COMPONENT_ERROR("parser", "Failed to parse file: {}", file_path);
-        return nullptr;
+// Helper, row/column of a byte offset, as tree-sitter expects in a TSInputEdit
+TSPoint point_at_byte(const std::string &source_content, uint32_t byte) {
+    TSPoint point{0, 0};
+    for (uint32_t i = 0; i < byte && i < source_content.size(); ++i) {
+        if (source_content[i] == '\n') {
+            point.row++;
+            point.column = 0;
+        } else {
+            point.column++;
+        }
     }
-    
-    return AST;
+    return point;
 }
 
-// Helper, parse all source files and store the syntax trees and source code content
-std::pair<std::unordered_map<std::string, TSTree*>, std::unordered_map<std::string, std::string>>
-parse_files_into_AST(const std::vector<std::string>& source_file_paths) {
-
+// Helper, describe the difference between two versions of a file as a single edit
+// (common prefix and suffix are kept, the middle is replaced)
+TSInputEdit compute_file_edit(const std::string &old_source, const std::string &new_source) {
+    size_t prefix = 0;
+    const size_t max_prefix = std::min(old_source.size(), new_source.size());
+    while (prefix < max_prefix && old_source[prefix] == new_source[prefix]) {
+        prefix++;
+    }
+    size_t suffix = 0;
+    while (suffix < max_prefix - prefix
+           && old_source[old_source.size() - 1 - suffix] == new_source[new_source.size() - 1 - suffix]) {
+        suffix++;
+    }
 
+    TSInputEdit edit;
+    edit.start_byte = static_cast<uint32_t>(prefix);
+    edit.old_end_byte = static_cast<uint32_t>(old_source.size() - suffix);
+    edit.new_end_byte = static_cast<uint32_t>(new_source.size() - suffix);
+    edit.start_point = point_at_byte(old_source, edit.start_byte);
+    edit.old_end_point = point_at_byte(old_source, edit.old_end_byte);
+    edit.new_end_point = point_at_byte(new_source, edit.new_end_byte);
+    return edit;
+}
 
-    // Maps to store: file_path -> AST and file_path -> source_content
-    std::unordered_map<std::string, TSTree*> path_to_AST;
-    std::unordered_map<std::string, std::string> source_content_path;
-    
-    for (const auto& curr_file_path : source_file_paths) { // read each cpp from src/
-        try {
-            // Read the source code from the file
-            std::string source_content = read_file(curr_file_path);
-            source_content_path[curr_file_path] = source_content;
-            
-            // Log information about the file
-            int total_file_lines = std::count(source_content.begin(), source_content.end(), '\n');
-            LOG_COMPONENT_INFO("parser", "File '{}' has {} lines", curr_file_path, total_file_lines);
-            
-            // Parse the source code into a syntax tree
-            TSTree* parsed_AST = parse_file_into_AST(curr_file_path, source_content);
-            if (parsed_AST) {
-                path_to_AST[curr_file_path] = parsed_AST;
-            }
-            
-        } catch (const std::exception& file_reading_error) {
-            LOG_COMPONENT_ERROR("parser", "Exception reading file {}: {}", curr_file_path, file_reading_error.what());
-            continue;
-        }
+// Helper, identifier-like tokens of a piece of source text
+void collect_identifier_tokens(const std::string &text, std::unordered_set<std::string> &names) {
+    static const std::regex identifier(R"([A-Za-z_][A-Za-z0-9_]*)");
+    for (auto it = std::sregex_iterator(text.begin(), text.end(), identifier); it != std::sregex_iterator(); ++it) {
+        names.insert(it->str());
     }
-    
-    return {path_to_AST, source_content_path};
 }
 
-// Helper, clean up Tree-sitter syntax tree memory
-void cleanup(const std::unordered_map<std::string, TSTree*>& path_to_AST) {
-    for (const auto& file_and_tree_pair : path_to_AST) {
-        ts_tree_delete(file_and_tree_pair.second);
+bool ranges_intersect(uint32_t a_start, uint32_t a_end, uint32_t b_start, uint32_t b_end) {
+    return a_start <= b_end && b_start <= a_end;
+}
+
+Parser::Parser() : ts_parser_(ts_parser_new()) {
+    // Tell the parser we're parsing C++ code
+    ts_parser_set_language(ts_parser_, tree_sitter_cpp());
+}
+
+Parser::~Parser() {
+    for (auto &entry : cache_) {
+        if (entry.second.tree) {
+            ts_tree_delete(entry.second.tree);
+        }
     }
+    ts_parser_delete(ts_parser_);
 }
 
 // Parse source code and extract syntax nodes for suspicious bug locations
@@ -171,79 +197,234 @@ std::vector<ASTNode> Parser::parseAST(
         "Starting AST parse: {} suspicious locations, {} source files",
         sus_loc.size(), source_file_paths.size());
 
-    auto [path_to_AST, source_content_path] = parse_files_into_AST(source_file_paths);
-
-    // Group SBFL locations by file
+    // Group SBFL locations by file, keyed by canonical path so they match the parsed spelling
     std::unordered_map<std::string,std::vector<SuspiciousLocation>> sus_by_file;
     for (auto &sl : sus_loc) {
-        sus_by_file[sl.file_path].push_back(sl);
+        sus_by_file[canonical_path(sl.file_path)].push_back(sl);
     }
 
     std::vector<ASTNode> nodes_AST;
     int unique_node_counter = 0;
 
-    // For each file, we will walk the full AST once using a helper function
-    for (auto &p : path_to_AST) {
-        const auto &file_path = p.first;
-        TSTree *tree = p.second;
-        const auto &source = source_content_path[file_path];
-
-        // Building parallel vectors of byte‐pos, score & reason
-        std::vector<uint32_t> sus_bytes;
-        std::vector<double> sus_scores;
-        std::vector<std::string> sus_reasons;
-        for (auto &sl : sus_by_file[file_path]) {
-            int byte = get_byte_position_for_line(source, sl.line_number);
-            if (byte >= 0) {
-                sus_bytes.push_back(sl.line_number);
-                sus_scores.push_back(sl.suspiciousness_score);
-                sus_reasons.push_back(sl.reason);
+    // The same file can reach us under several spellings (source discovery, SBFL paths),
+    // only the first one is parsed so every shared header is parsed exactly once
+    std::unordered_set<std::string> seen_files;
+
+    for (const auto &file_path : source_file_paths) { // read each source and header once
+        const std::string key = canonical_path(file_path);
+        if (!seen_files.insert(key).second) {
+            continue;
+        }
+
+        std::string source;
+        try {
+            source = read_file(file_path);
+        } catch (const std::exception& file_reading_error) {
+            LOG_COMPONENT_ERROR("parser", "Exception reading file {}: {}", file_path, file_reading_error.what());
+            continue;
+        }
+
+        // Log information about the file
+        int total_file_lines = std::count(source.begin(), source.end(), '\n');
+        LOG_COMPONENT_INFO("parser", "File '{}' has {} lines", file_path, total_file_lines);
+
+        auto &cached = cache_[key];
+        parseFile(file_path, source, cached, sus_by_file[key], unique_node_counter, nodes_AST);
+        if (!cached.tree) {
+            cache_.erase(key);
+        }
+    }
+
+    LOG_COMPONENT_INFO("parser", "Returning {} AST nodes covering suspicious locations",
+                    nodes_AST.size());
+    return nodes_AST;
+}
+
+void Parser::parseFile(const std::string &file_path, const std::string &source, ParsedFile &cached,
+                       const std::vector<SuspiciousLocation> &sus_loc,
+                       int &unique_node_counter, std::vector<ASTNode> &nodes_AST) {
+    // Ranges (in new byte offsets) whose syntax changed since the previous round, and the
+    // identifiers appearing in the edited text. Without a previous tree there is nothing to reuse.
+    const bool has_previous = cached.tree != nullptr;
+    std::vector<std::pair<uint32_t, uint32_t>> changed_ranges;
+    std::unordered_set<std::string> changed_names;
+    TSInputEdit edit{};
+    TSTree *tree = cached.tree;
+
+    if (!has_previous || cached.source != source) {
+        if (has_previous) {
+            edit = compute_file_edit(cached.source, source);
+            ts_tree_edit(cached.tree, &edit);
+            changed_ranges.emplace_back(edit.start_byte, edit.new_end_byte);
+            collect_identifier_tokens(cached.source.substr(edit.start_byte, edit.old_end_byte - edit.start_byte), changed_names);
+            collect_identifier_tokens(source.substr(edit.start_byte, edit.new_end_byte - edit.start_byte), changed_names);
+        }
+
+        // Reparse, handing tree-sitter the edited old tree so unchanged subtrees are reused
+        tree = ts_parser_parse_string(ts_parser_, cached.tree, source.c_str(), source.size());
+        if (!tree) {
+            LOG_COMPONENT_ERROR("parser", "Failed to parse file: {}", file_path);
+            // The old tree was already edited towards the new text and no longer matches cached.source,
+            // the caller drops the entry so the next round parses the file from scratch
+            if (has_previous) {
+                ts_tree_delete(cached.tree);
             }
+            cached = ParsedFile{};
+            return;
         }
 
-        // Function to help recursively walk the AST once per file. 
-        std::function<void(TSNode,TSNode)> walk = [&](TSNode node, TSNode root) {
-            // Determine if this node covers any of our sus_bytes
-            double score = 0.0;
-            std::string reason;
-            auto startPoint = ts_node_start_point(node);
-            auto endPoint = ts_node_end_point(node);
-            int start_line = startPoint.row + 1;
-            int end_line = endPoint.row + 1;
-            
-            // Collecting all SBFL entries whose line falls in [start_line,end_line]
-            for (size_t i = 0; i < sus_bytes.size(); ++i) {
-                int sl = static_cast<int>(sus_bytes[i]);
-                if (sl >= start_line && sl <= end_line) {
-                    score  = sus_scores[i];
-                    reason = sus_reasons[i];
-                    break;
-                }
+        if (has_previous) {
+            uint32_t range_count = 0;
+            TSRange *ranges = ts_tree_get_changed_ranges(cached.tree, tree, &range_count);
+            for (uint32_t i = 0; i < range_count; ++i) {
+                changed_ranges.emplace_back(ranges[i].start_byte, ranges[i].end_byte);
+                collect_identifier_tokens(source.substr(ranges[i].start_byte, ranges[i].end_byte - ranges[i].start_byte), changed_names);
             }
+            free(ranges);
+            ts_tree_delete(cached.tree);
+        }
+    }
 
-            if (ts_node_is_named(node)) {
-                std::string type_str = ts_node_type(node);
-                if(type_str != "translation_unit" && type_str != "preproc_include"){
-                    nodes_AST.push_back(
-                        create_ast_node(node, root, source, unique_node_counter, file_path, score, reason)
-                    );
-                }
+    // Index the previous round's nodes by (start byte, end byte, type) in old offsets
+    std::unordered_map<std::string, const ASTNode *> previous_nodes;
+    if (has_previous) {
+        for (const auto &node : cached.nodes) {
+            previous_nodes[std::to_string(node.start_byte) + ":" + std::to_string(node.end_byte) + ":" + node.node_type] = &node;
+        }
+    }
+    const bool unchanged = has_previous && changed_ranges.empty();
+    const int64_t shift = static_cast<int64_t>(edit.old_end_byte) - static_cast<int64_t>(edit.new_end_byte);
+
+    auto intersects_change = [&](uint32_t start, uint32_t end) {
+        for (const auto &range : changed_ranges) {
+            if (ranges_intersect(start, end, range.first, range.second)) return true;
+        }
+        return false;
+    };
+
+    // Find the node's counterpart in the previous round and decide which of its contexts are still valid:
+    //  - variable context depends only on the node's own subtree
+    //  - genealogy context depends on its ancestors and the children of its nearest enclosing block
+    //  - dependency context depends on every definition and use of its variables in the file
+    auto find_reusable = [&](TSNode node, uint32_t block_start, uint32_t block_end) -> ContextReuse {
+        ContextReuse reuse;
+        if (!has_previous) return reuse;
+
+        uint32_t start = ts_node_start_byte(node);
+        uint32_t end = ts_node_end_byte(node);
+        int64_t old_start = start, old_end = end;
+        if (!unchanged && start >= edit.new_end_byte) {
+            old_start += shift;
+            old_end += shift;
+        } else if (!unchanged && end > edit.start_byte) {
+            return reuse; // overlaps the edit, no counterpart
+        }
+
+        auto it = previous_nodes.find(std::to_string(old_start) + ":" + std::to_string(old_end) + ":" + ts_node_type(node));
+        if (it == previous_nodes.end()) return reuse;
+        reuse.cached = it->second;
+        if (unchanged) {
+            reuse.genealogy = reuse.variable = reuse.dependency = true;
+            return reuse;
+        }
+
+        reuse.variable = !intersects_change(start, end);
+        reuse.genealogy = reuse.variable && !intersects_change(block_start, block_end);
+        reuse.dependency = reuse.variable;
+        for (const auto &kv : reuse.cached->variable_context.var_counts) {
+            if (!reuse.dependency) break;
+            if (changed_names.count(kv.first.substr(kv.first.find('#') + 1))) {
+                reuse.dependency = false;
             }
+        }
+        return reuse;
+    };
 
-            uint32_t count = ts_node_named_child_count(node);
-            for (uint32_t i = 0; i < count; ++i) {
-                walk(ts_node_named_child(node, i), root);
+    // Building parallel vectors of byte‐pos, score & reason
+    std::vector<uint32_t> sus_bytes;
+    std::vector<double> sus_scores;
+    std::vector<std::string> sus_reasons;
+    for (auto &sl : sus_loc) {
+        int byte = get_byte_position_for_line(source, sl.line_number);
+        if (byte >= 0) {
+            sus_bytes.push_back(sl.line_number);
+            sus_scores.push_back(sl.suspiciousness_score);
+            sus_reasons.push_back(sl.reason);
+        }
+    }
+
+    std::vector<ASTNode> file_nodes;
+    size_t reused_contexts = 0;
+
+    // Scope information depends on every declaration in the file, it is rebuilt on each parse
+    const ScopeTree scopes(ts_tree_root_node(tree), source);
+
+    // Function to help recursively walk the AST once per file. The range of the nearest enclosing
+    // block is passed down for the genealogy reuse check.
+    std::function<void(TSNode,TSNode,uint32_t,uint32_t)> walk = [&](TSNode node, TSNode root,
+                                                                    uint32_t block_start, uint32_t block_end) {
+        // Determine if this node covers any of our sus_bytes
+        double score = 0.0;
+        std::string reason;
+        int suspicious_line = 0;
+        auto startPoint = ts_node_start_point(node);
+        auto endPoint = ts_node_end_point(node);
+        int start_line = startPoint.row + 1;
+        int end_line = endPoint.row + 1;
+        
+        // Collecting all SBFL entries whose line falls in [start_line,end_line]
+        for (size_t i = 0; i < sus_bytes.size(); ++i) {
+            int sl = static_cast<int>(sus_bytes[i]);
+            if (sl >= start_line && sl <= end_line) {
+                score  = sus_scores[i];
+                reason = sus_reasons[i];
+                suspicious_line = sl;
+                break;
+            }
+        }
+
+        std::string type_str = ts_node_type(node);
+        if (ts_node_is_named(node)) {
+            if(type_str != "translation_unit" && type_str != "preproc_include"){
+                ContextReuse reuse = find_reusable(node, block_start, block_end);
+                reused_contexts += reuse.genealogy + reuse.variable + reuse.dependency;
+                // Names the node needs, and for targets the names visible where it sits
+                ScopeContext scope_context = scopes.contextOf(ts_node_start_byte(node), ts_node_end_byte(node), score > 0.0);
+                file_nodes.push_back(
+                    create_ast_node(node, root, source, unique_node_counter, file_path, score, reason, reuse,
+                                    std::move(scope_context))
+                );
+                file_nodes.back().inferred_type = scopes.typeOf(node);
+                file_nodes.back().suspicious_line = suspicious_line;
             }
-        };
+        }
+
+        if (type_str == "block") {
+            block_start = ts_node_start_byte(node);
+            block_end = ts_node_end_byte(node);
+        }
+        uint32_t count = ts_node_named_child_count(node);
+        for (uint32_t i = 0; i < count; ++i) {
+            walk(ts_node_named_child(node, i), root, block_start, block_end);
+        }
+    };
+
+    TSNode root = ts_tree_root_node(tree);
+    walk(root, root, ts_node_start_byte(root), ts_node_end_byte(root));
 
-        TSNode root = ts_tree_root_node(tree);
-        walk(root, root);
+    if (has_previous) {
+        LOG_COMPONENT_INFO("parser", "File '{}' reparsed incrementally: {} changed ranges, {}/{} contexts reused",
+            file_path, changed_ranges.size(), reused_contexts, file_nodes.size() * 3);
+    }
+    if (Trace::enabled(Trace::Stage::Parser)) {
+        Trace::emit(Trace::Stage::Parser, "file", {{"file_path", file_path}, {"nodes", file_nodes.size()},
+                                                  {"incremental", has_previous}, {"reused_contexts", reused_contexts}});
     }
 
-    cleanup(path_to_AST);
-    LOG_COMPONENT_INFO("parser", "Returning {} AST nodes covering suspicious locations",
-                    nodes_AST.size());
-    return nodes_AST;
+    nodes_AST.insert(nodes_AST.end(), file_nodes.begin(), file_nodes.end());
+    cached.tree = tree;
+    cached.source = source;
+    cached.nodes = std::move(file_nodes);
 }
 
-}
\ No newline at end of file
+}
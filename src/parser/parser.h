@@ -2,23 +2,34 @@
 
 #include "../core/contracts.h"
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+struct TSParser;
+struct TSTree;
+
 namespace apr_system {
 
 /**
- * @brief stub implementation of AST parser
+ * @brief tree-sitter based AST parser
  *
- * this is a stub to implement AST parsing.
- * currently returns mock data for testing the data flow between modules.
+ * parses source files and extracts syntax nodes with their genealogy,
+ * variable and dependency contexts. syntax trees are kept alive across
+ * calls, so a later parseAST on the same Parser (after a patch was kept, or
+ * on the next commit) reparses changed files incrementally and recomputes
+ * only the contexts the edit can affect. the pipeline parses once per run
+ * for now, nothing calls parseAST a second time yet.
  */
 class Parser : public IParser {
 public:
-  Parser() = default;
-  ~Parser() = default;
+  Parser();
+  ~Parser() override;
+
+  Parser(const Parser &) = delete;
+  Parser &operator=(const Parser &) = delete;
 
   /**
-   * @brief stub method for AST parsing
+   * @brief parse source files and extract AST nodes
    *
    * @param suspicious_locations locations identified by SBFL with file_path and
    * line_number
@@ -29,6 +40,35 @@ public:
   std::vector<ASTNode>
   parseAST(const std::vector<SuspiciousLocation> &suspicious_locations,
            const std::vector<std::string> &source_files) override;
+
+private:
+  /**
+   * @brief syntax tree and extracted nodes of a file from the previous round
+   */
+  struct ParsedFile {
+    TSTree *tree = nullptr;
+    std::string source;
+    std::vector<ASTNode> nodes;
+  };
+
+  /**
+   * @brief parse one file, reusing the cached tree and contexts if present
+   * @param file_path path reported on the extracted nodes
+   * @param source current content of the file
+   * @param cached previous round for this file, updated in place and left
+   * without a tree if the file failed to parse
+   * @param sus_loc SBFL locations in this file
+   * @param unique_node_counter running counter for node ids
+   * @param nodes_AST output vector
+   */
+  void parseFile(const std::string &file_path, const std::string &source,
+                 ParsedFile &cached,
+                 const std::vector<SuspiciousLocation> &sus_loc,
+                 int &unique_node_counter, std::vector<ASTNode> &nodes_AST);
+
+  TSParser *ts_parser_;
+  // canonical file path -> previous round
+  std::unordered_map<std::string, ParsedFile> cache_;
 };
 
 } // namespace apr_system
@@ -0,0 +1,252 @@
+#include "scope_tree.h"
+#include <algorithm>
+#include <set>
+
+namespace apr_system {
+
+namespace {
+
+bool is_one_of(const std::string &type, std::initializer_list<const char *> types) {
+    for (const char *t : types) {
+        if (type == t) return true;
+    }
+    return false;
+}
+
+// Helper, the identifier a declarator declares, or a null node (qualified names, operators, ...)
+TSNode declarator_name(TSNode node) {
+    while (!ts_node_is_null(node)) {
+        const std::string type = ts_node_type(node);
+        if (type == "identifier" || type == "field_identifier") {
+            return node;
+        }
+        if (is_one_of(type, {"qualified_identifier", "destructor_name", "operator_name",
+                             "template_function", "operator_cast"})) {
+            break;
+        }
+        TSNode inner = ts_node_child_by_field_name(node, "declarator", 10);
+        if (ts_node_is_null(inner)) {
+            // reference_declarator has no field name for the declarator it wraps
+            const uint32_t count = ts_node_named_child_count(node);
+            if (count == 0) break;
+            inner = ts_node_named_child(node, count - 1);
+        }
+        node = inner;
+    }
+    return TSNode{};
+}
+
+// Helper, whether a function declarator names a qualified (out-of-line) function like Foo::bar
+bool declares_qualified_name(TSNode node) {
+    while (!ts_node_is_null(node)) {
+        const std::string type = ts_node_type(node);
+        if (type == "qualified_identifier") return true;
+        if (type == "identifier" || type == "field_identifier") return false;
+        node = ts_node_child_by_field_name(node, "declarator", 10);
+    }
+    return false;
+}
+
+// Helper, pointer/array levels of a declarator and whether it declares a function
+void declarator_shape(TSNode node, int &indirections, bool &function) {
+    while (!ts_node_is_null(node)) {
+        const std::string type = ts_node_type(node);
+        if (type == "pointer_declarator" || type == "array_declarator") {
+            ++indirections;
+        } else if (type == "function_declarator") {
+            function = true;
+        } else if (type == "identifier" || type == "field_identifier" || type == "qualified_identifier") {
+            return;
+        }
+        TSNode inner = ts_node_child_by_field_name(node, "declarator", 10);
+        if (ts_node_is_null(inner)) {
+            const uint32_t count = ts_node_named_child_count(node);
+            if (count == 0) return;
+            inner = ts_node_named_child(node, count - 1);
+        }
+        node = inner;
+    }
+}
+
+bool is_declarator(const std::string &type) {
+    return is_one_of(type, {"identifier", "field_identifier", "init_declarator", "pointer_declarator",
+                            "reference_declarator", "array_declarator", "function_declarator"});
+}
+
+} // namespace
+
+ScopeTree::ScopeTree(TSNode root, const std::string &source) : source_(source) {
+    scopes_.push_back({Kind::File, ts_node_start_byte(root), ts_node_end_byte(root), -1, false, {}});
+    const uint32_t count = ts_node_named_child_count(root);
+    for (uint32_t i = 0; i < count; ++i) {
+        visit(ts_node_named_child(root, i), 0);
+    }
+    resolve();
+}
+
+std::string ScopeTree::text(TSNode node) const {
+    const uint32_t start = ts_node_start_byte(node);
+    return source_.substr(start, ts_node_end_byte(node) - start);
+}
+
+void ScopeTree::declare(int scope, TSNode declarator, TSNode type) {
+    TSNode name = declarator_name(declarator);
+    if (ts_node_is_null(name)) return;
+    declarator_names_.insert(ts_node_start_byte(name));
+
+    Declaration declaration{ts_node_end_byte(name), "", false}; // declared right after the name
+    if (!ts_node_is_null(type) && std::string(ts_node_type(type)) != "placeholder_type_specifier") {
+        int indirections = 0;
+        declarator_shape(declarator, indirections, declaration.function);
+        declaration.type = text(type) + std::string(indirections, '*');
+    }
+    scopes_[scope].names.try_emplace(text(name), std::move(declaration));
+}
+
+void ScopeTree::visit(TSNode node, int scope) {
+    const std::string type = ts_node_type(node);
+
+    if (type == "identifier") {
+        if (!declarator_names_.count(ts_node_start_byte(node))) {
+            uses_.push_back({ts_node_start_byte(node), text(node), scope});
+        }
+        return;
+    }
+    if (type == "qualified_identifier") {
+        return; // qualified lookups are left unresolved
+    }
+
+    int inner = scope;
+    auto open = [&](Kind kind) {
+        scopes_.push_back({kind, ts_node_start_byte(node), ts_node_end_byte(node), scope, false, {}});
+        inner = static_cast<int>(scopes_.size()) - 1;
+    };
+
+    if (type == "namespace_definition") {
+        open(Kind::File);
+    } else if (is_one_of(type, {"class_specifier", "struct_specifier", "union_specifier"})) {
+        open(Kind::Class);
+    } else if (type == "function_definition") {
+        TSNode declarator = ts_node_child_by_field_name(node, "declarator", 10);
+        declare(scope, declarator, ts_node_child_by_field_name(node, "type", 4));
+        const bool out_of_line = declares_qualified_name(declarator);
+        open(Kind::Function);
+        scopes_[inner].unknown_class = out_of_line;
+    } else if (type == "lambda_expression") {
+        open(Kind::Function);
+    } else if (is_one_of(type, {"compound_statement", "for_statement", "for_range_loop", "catch_clause",
+                                "if_statement", "while_statement", "switch_statement"})) {
+        open(Kind::Block);
+    }
+
+    TSNode declared_type = ts_node_child_by_field_name(node, "type", 4);
+    if (type == "parameter_declaration" || type == "optional_parameter_declaration") {
+        declare(inner, ts_node_child_by_field_name(node, "declarator", 10), declared_type);
+    } else if (type == "declaration" || type == "field_declaration") {
+        const uint32_t count = ts_node_named_child_count(node);
+        for (uint32_t i = 0; i < count; ++i) {
+            TSNode child = ts_node_named_child(node, i);
+            if (is_declarator(ts_node_type(child))) {
+                declare(inner, child, declared_type);
+            }
+        }
+    } else if (type == "for_range_loop") {
+        declare(inner, ts_node_child_by_field_name(node, "declarator", 10), declared_type);
+    } else if (is_one_of(type, {"enumerator", "preproc_def", "preproc_function_def"})) {
+        declare(inner, ts_node_child_by_field_name(node, "name", 4), TSNode{});
+    }
+
+    const uint32_t count = ts_node_named_child_count(node);
+    for (uint32_t i = 0; i < count; ++i) {
+        visit(ts_node_named_child(node, i), inner);
+    }
+}
+
+void ScopeTree::resolve() {
+    for (const auto &use : uses_) {
+        for (int s = use.scope; s >= 0; s = scopes_[s].parent) {
+            const Scope &scope = scopes_[s];
+            auto it = scope.names.find(use.name);
+            if (it == scope.names.end()) continue;
+            const bool ordered = scope.kind == Kind::Function || scope.kind == Kind::Block;
+            if (ordered && it->second.declared_at > use.byte) continue; // declared later, an outer name is meant
+            if (scope.kind != Kind::File) {
+                resolved_.push_back({use.byte, use.name, scope.kind, it->second.declared_at});
+            }
+            if (!it->second.type.empty()) {
+                use_types_.emplace(use.byte, it->second);
+            }
+            break;
+        }
+    }
+    std::sort(resolved_.begin(), resolved_.end(), [](const ResolvedUse &a, const ResolvedUse &b) {
+        return a.byte < b.byte;
+    });
+    uses_.clear();
+}
+
+ScopeContext ScopeTree::contextOf(uint32_t start_byte, uint32_t end_byte, bool with_visible) const {
+    std::set<std::string> locals, members;
+    auto it = std::lower_bound(resolved_.begin(), resolved_.end(), start_byte,
+                               [](const ResolvedUse &use, uint32_t byte) { return use.byte < byte; });
+    for (; it != resolved_.end() && it->byte < end_byte; ++it) {
+        if (it->declared_at > start_byte && it->declared_at <= end_byte) {
+            continue; // declared by the node itself, travels with it
+        }
+        (it->kind == Kind::Class ? members : locals).insert(it->name);
+    }
+
+    ScopeContext context;
+    context.required_locals.assign(locals.begin(), locals.end());
+    context.required_members.assign(members.begin(), members.end());
+    if (!with_visible) return context;
+
+    int innermost = 0;
+    for (size_t s = 0; s < scopes_.size(); ++s) {
+        if (scopes_[s].start <= start_byte && start_byte < scopes_[s].end) {
+            innermost = static_cast<int>(s);
+        }
+    }
+    std::set<std::string> visible;
+    for (int s = innermost; s >= 0; s = scopes_[s].parent) {
+        const Scope &scope = scopes_[s];
+        context.open_members = context.open_members || scope.unknown_class;
+        const bool ordered = scope.kind == Kind::Function || scope.kind == Kind::Block;
+        for (const auto &[name, declaration] : scope.names) {
+            if (!ordered || declaration.declared_at <= start_byte) {
+                visible.insert(name);
+            }
+        }
+    }
+    context.visible_names.assign(visible.begin(), visible.end());
+    return context;
+}
+
+std::string ScopeTree::typeOf(TSNode node) const {
+    const std::string type = ts_node_type(node);
+    if (type == "number_literal") {
+        const std::string literal = text(node);
+        const bool floating = literal.find_first_of(".eEpP") != std::string::npos &&
+                              literal.rfind("0x", 0) != 0 && literal.rfind("0X", 0) != 0;
+        return floating ? "double" : "int";
+    }
+    if (type == "string_literal" || type == "raw_string_literal") return "const char*";
+    if (type == "char_literal") return "char";
+    if (type == "true" || type == "false") return "bool";
+    if (type == "parenthesized_expression" && ts_node_named_child_count(node) == 1) {
+        return typeOf(ts_node_named_child(node, 0));
+    }
+
+    bool call = false;
+    if (type == "call_expression") {
+        node = ts_node_child_by_field_name(node, "function", 8);
+        call = true;
+    }
+    if (ts_node_is_null(node) || std::string(ts_node_type(node)) != "identifier") return "";
+    auto it = use_types_.find(ts_node_start_byte(node));
+    // a bare function name is not a value of its return type
+    if (it == use_types_.end() || it->second.function != call) return "";
+    return it->second.type;
+}
+
+} // namespace apr_system
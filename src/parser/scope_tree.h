@@ -0,0 +1,111 @@
+#pragma once
+
+#include "../core/types.h"
+#include <tree_sitter/api.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace apr_system {
+
+/**
+ * @brief lightweight scope tree of one source file
+ *
+ * records file scope (translation unit and namespaces), class bodies,
+ * functions (with their parameters) and blocks, together with the names
+ * declared in each. identifiers are resolved with C++ visibility rules
+ * (locals only after their declaration, members and file-scope names
+ * anywhere), which is enough to tell whether an ingredient can be spliced
+ * in at a target without referring to names that do not exist there.
+ *
+ * every declaration also keeps its declared type, so the type of an
+ * identifier or of a call to a known function can be looked up.
+ *
+ * resolution is best-effort: qualified names, names from included headers
+ * and members of out-of-line member functions are left unresolved and never
+ * block a candidate.
+ */
+class ScopeTree {
+public:
+  /**
+   * @brief build the scope tree of a parsed file
+   * @param root root node of the file's syntax tree
+   * @param source content of the file
+   */
+  ScopeTree(TSNode root, const std::string &source);
+
+  /**
+   * @brief scope information of a node
+   * @param start_byte start of the node
+   * @param end_byte end of the node
+   * @param with_visible also list the names visible at start_byte
+   * @return required locals/members of the node (declarations inside the
+   * node itself excluded) and, if requested, the visible names
+   */
+  ScopeContext contextOf(uint32_t start_byte, uint32_t end_byte,
+                         bool with_visible) const;
+
+  /**
+   * @brief declared type of the value an expression evaluates to
+   *
+   * known for literals, identifiers of declared variables and calls of
+   * declared functions (their return type). the type is the declaration's
+   * type text with one '*' per pointer or array level.
+   *
+   * @param node expression node of this file
+   * @return the type, empty when unknown
+   */
+  std::string typeOf(TSNode node) const;
+
+private:
+  enum class Kind { File, Class, Function, Block };
+
+  struct Declaration {
+    // point of declaration (end of the declarator name)
+    uint32_t declared_at;
+    std::string type;
+    bool function;
+  };
+
+  struct Scope {
+    Kind kind;
+    uint32_t start;
+    uint32_t end;
+    int parent;
+    // out-of-line member function, the class is not known here
+    bool unknown_class = false;
+    std::unordered_map<std::string, Declaration> names;
+  };
+
+  struct Use {
+    uint32_t byte;
+    std::string name;
+    int scope;
+  };
+
+  struct ResolvedUse {
+    uint32_t byte;
+    std::string name;
+    Kind kind;
+    uint32_t declared_at;
+  };
+
+  void visit(TSNode node, int scope);
+  void declare(int scope, TSNode declarator, TSNode type);
+  void resolve();
+  std::string text(TSNode node) const;
+
+  const std::string &source_;
+  // preorder, so the last scope containing a byte is the innermost one
+  std::vector<Scope> scopes_;
+  std::vector<Use> uses_;
+  std::unordered_set<uint32_t> declarator_names_;
+  // uses that resolved to a local or member declaration, ordered by byte
+  std::vector<ResolvedUse> resolved_;
+  // start byte of a use -> the declaration it resolved to, when its type is known
+  std::unordered_map<uint32_t, Declaration> use_types_;
+};
+
+} // namespace apr_system
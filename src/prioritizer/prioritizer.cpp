@@ -1,123 +1,91 @@
 #include "prioritizer.h"
 #include "../core/logger.h"
+#include "../core/parallel.h"
+#include "../core/trace.h"
+#include <algorithm>
 
 
 namespace apr_system {
 
-std::vector<PatchCandidate> Prioritizer::prioritizePatches(
+std::vector<RankedPatch> Prioritizer::prioritizePatches(
     const std::vector<PatchCandidate>& patch_candidates,
-    const std::string& mutation_freq_json
+    const std::string& mutation_freq_json,
+    size_t top_k
 ) {
     LOG_COMPONENT_INFO("prioritizer", "input: {} patch candidates", patch_candidates.size());
 
-    std::unordered_map<std::string, std::vector<FreqEntry>> freqMap = parseFrequencyFile(mutation_freq_json);
+    if (mutation_freq_json.empty()) {
+        if (!frequencies_ || !frequencies_->sourcePath().empty()) frequencies_ = FrequencyModel::builtin();
+    } else if (!frequencies_ || frequencies_->sourcePath() != mutation_freq_json) {
+        LOG_COMPONENT_INFO("prioritizer", "parsing JSON mutation frequencies from: {}", mutation_freq_json);
+        try {
+            frequencies_ = FrequencyModel::load(mutation_freq_json);
+        } catch (const std::exception& e) {
+            LOG_COMPONENT_ERROR("prioritizer", "error parsing JSON frequency file: {}", e.what());
+            frequencies_ = FrequencyModel::fromEntries({}, mutation_freq_json);
+        }
+    }
+    const FrequencyModel& frequencies = *frequencies_;
 
-    std::vector<PatchCandidate> prioritized_patches;
     LOG_COMPONENT_INFO("prioritizer", "computing priority scores...");
 
-    // create mock prioritized patches
-    for (size_t i = 0; i < patch_candidates.size(); ++i) {
-        PatchCandidate candidate = patch_candidates[i];
-        const double score = computePriorityScore(candidate, freqMap);
-        candidate.priority_score = score;
-        // Cuts out any patches with a score of 0
-        if (score > 0.0) {
-            prioritized_patches.push_back(std::move(candidate));
+    // candidates are scored a chunk at a time, each chunk one feature matrix
+    constexpr size_t kChunk = 1024;
+    const size_t n = patch_candidates.size();
+    std::vector<double> scores(n);
+    parallelFor((n + kChunk - 1) / kChunk, num_threads_, [&](size_t, size_t chunk){
+        const size_t begin = chunk * kChunk;
+        const size_t end = std::min(n, begin + kChunk);
+        const auto rows = std::span(patch_candidates).subspan(begin, end - begin);
+        const auto block = std::span(scores).subspan(begin, end - begin);
+        ranking_.score(FeatureMatrix::extract(rows, frequencies), block);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (!hasEvidence(rows[i], frequencies)) block[i] = 0.0;
+            else if (knowledge_) block[i] *= knowledge_->boost(KnowledgeBase::key(rows[i]));
         }
-    }
-    
-    std::sort(prioritized_patches.begin(), prioritized_patches.end(), 
-            [](const PatchCandidate& a, const PatchCandidate& b) {
-                    return a.priority_score > b.priority_score;
     });
-    // printPrioritizedPatches(prioritized_patches);
-
-    dumpPrioritizedPatchesToFile(prioritized_patches);
-
-    LOG_COMPONENT_INFO("prioritizer", "prioritized {} patches", prioritized_patches.size());
-    return prioritized_patches;
-}
-
-double Prioritizer::computePriorityScore(
-    const PatchCandidate& patch, 
-    std::unordered_map<std::string, std::vector<FreqEntry>>& freqMap 
-) const {
-    double similarity = patch.similarity_score;
-    double suspiciousness_score = patch.suspiciousness_score;
-    double freqScore = 0.0;
 
-    std::string category = patch.mutation_type.mutation_category;
-    std::string target = patch.mutation_type.target_node;
-    std::string source = patch.mutation_type.source_node;
-
-    std::vector<FreqEntry> entries = freqMap[category];
+    // Cuts out any patches with a score of 0
+    std::vector<size_t> order;
+    order.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (scores[i] > 0.0) order.push_back(i);
+    }
 
-    for (const auto& entry : entries) {
-        if (category == "Replacement") {
-            if (entry.target_node == target) {
-                freqScore = entry.freq;
-            }
-        } else {
-            if (entry.target_node == target && entry.source_node == source) {
-                freqScore = entry.freq;
-            }
+    // only the first top_k positions are ordered, the rest is dropped
+    const size_t k = top_k == 0 ? order.size() : std::min(top_k, order.size());
+    const auto better = [&scores](size_t a, size_t b) {
+        return scores[a] != scores[b] ? scores[a] > scores[b] : a < b;
+    };
+    std::partial_sort(order.begin(), order.begin() + k, order.end(), better);
+
+    std::vector<RankedPatch> ranking;
+    ranking.reserve(k);
+    for (size_t r = 0; r < k; ++r) ranking.push_back({order[r], scores[order[r]]});
+
+    if (Trace::enabled(Trace::Stage::Prioritizer)) {
+        for (const auto& ranked : ranking) {
+            nlohmann::json record = patch_candidates[ranked.candidate];
+            record["priority_score"] = ranked.priority_score;
+            Trace::emit(Trace::Stage::Prioritizer, "prioritized", std::move(record));
         }
     }
-    return similarity * suspiciousness_score * freqScore;
-    // return similarity * suspiciousness_score;
+
+    LOG_COMPONENT_INFO("prioritizer", "prioritized {} patches, ranked the top {}", order.size(), ranking.size());
+    return ranking;
 }
 
-// helper function to add mutation frequencies to mapping
-void addToFreqMap(
-    const nlohmann::json& data, 
-    std::unordered_map<std::string, std::vector<FreqEntry>>& freqMap,
-    std::string mutation
+std::unique_ptr<IValidationQueue> Prioritizer::validationQueue(
+    const std::vector<PatchCandidate>& patch_candidates,
+    const std::vector<RankedPatch>& prioritized_patches
 ) {
-    std::vector<FreqEntry> freqEntries;
-
-    if (data.contains(mutation)) {
-        const auto& data_array = data[mutation];
-        for (const auto& item : data_array) {
-            FreqEntry freqEntry;
-            std::string target = item.value("target", "unknown");
-            std::string source = item.value("source", "unknown");
-            double freq = item.value("freq", 0.0);
-
-            freqEntry.target_node = target;
-            freqEntry.source_node = source;
-            freqEntry.freq = freq;
-            freqEntries.push_back(freqEntry);
-        }
-
-        freqMap[mutation] = freqEntries;
-    }
+    return std::make_unique<AdaptiveValidationQueue>(patch_candidates, prioritized_patches, diversity_);
 }
 
-std::unordered_map<std::string, std::vector<FreqEntry>> 
-Prioritizer::parseFrequencyFile(const std::string& freqFile) const {
-    std::unordered_map<std::string, std::vector<FreqEntry>> freqMap;
-
-    LOG_COMPONENT_INFO("prioritizer", "parsing JSON mutation frequencies from: {}", freqFile);
-
-    try {
-        std::ifstream file(freqFile);
-        if (!file.is_open()) {
-            throw std::runtime_error("failed to open output file: " + freqFile);
-        }
-
-        nlohmann::json data = nlohmann::json::parse(file);
-
-        addToFreqMap(data, freqMap, "Replacement");
-        addToFreqMap(data, freqMap, "Insertion");
-        addToFreqMap(data, freqMap, "Deletion");
-
-        // printFreqMap(freqMap);
-    } catch (const std::exception& e) {
-        LOG_COMPONENT_ERROR("prioritizer", "error parsing JSON frequency file: {}", e.what());
-    }
-
-    return freqMap;
+bool Prioritizer::hasEvidence(const PatchCandidate& patch, const FrequencyModel& frequencies) {
+    // one probe into the shared model, replacements match on the target alone
+    return patch.similarity_score > 0.0 && patch.suspiciousness_score > 0.0 &&
+           frequencies.lookup(patch.mutation_type) > 0.0;
 }
 
-
 } // namespace apr_system
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "../core/contracts.h"
+#include "../core/frequency_model.h"
+#include "../core/knowledge_base.h"
+#include "ranking_model.h"
+#include "validation_queue.h"
 #include <memory>
 #include <unordered_map>
 #include <fstream>
@@ -22,52 +26,74 @@ public:
 
   /**
    * @brief prioritize patch candidates based on various heuristics
+   *
+   * features are extracted and scored by the ranking model in parallel
+   * chunks into a flat array, then only the top_k indices are selected and
+   * sorted; no candidate is copied. candidates whose similarity,
+   * suspiciousness or frequency is 0 are never ranked.
+   *
    * @param patch_candidates list of patch candidates
-   * @param test_results test execution results for feature extraction
-   * @param mutation_freq_json mutation frequencies
-   * @return vector of prioritized patches sorted by priority score
+   * @param mutation_freq_json mutation frequencies, empty for the built-in ones
+   * @param top_k length of the ranking, 0 ranks every scoring candidate
+   * @return indices of the best candidates with a positive score, best first,
+   * ties in candidate order
    */
-  std::vector<PatchCandidate>
+  std::vector<RankedPatch>
   prioritizePatches(const std::vector<PatchCandidate> &patch_candidates,
-                    const std::string& mutation_freq_json);
+                    const std::string& mutation_freq_json, size_t top_k = 0) override;
+
+  /**
+   * @brief an AdaptiveValidationQueue over the ranking, see setDiversity
+   */
+  std::unique_ptr<IValidationQueue>
+  validationQueue(const std::vector<PatchCandidate> &patch_candidates,
+                  const std::vector<RankedPatch> &prioritized_patches) override;
+
+  /**
+   * @brief use an already loaded frequency model (e.g. the mutator's)
+   *
+   * prioritizePatches only loads mutation_freq_json itself when no model
+   * was set or the set one came from a different file.
+   */
+  void setFrequencyModel(std::shared_ptr<const FrequencyModel> frequencies) {
+    frequencies_ = std::move(frequencies);
+  }
+
+  /**
+   * @brief number of scoring threads, 0 uses the hardware concurrency
+   */
+  void setThreadCount(size_t num_threads) { num_threads_ = num_threads; }
 
-private:
   /**
-   * @brief extract features from a patch candidate
-   * @param patch patch candidate to analyze
-   * @param test_results test results for context
-   * @return vector of feature strings
+   * @brief rank with a trained model instead of the plain product
    */
-  std::vector<std::string>
-  extractFeatures(const PatchCandidate &patch,
-                  const std::vector<TestResult> &test_results) const;
+  void setRankingModel(RankingModel model) { ranking_ = std::move(model); }
 
   /**
-   * @brief compute priority score based on features
-   * @param patch patch candidate to compute priority score 
-   * @param freqMap frequency mapping from historical data
-   * @return priority score (higher is better)
+   * @brief boost candidates whose fix shape worked in earlier runs by
+   * KnowledgeBase::boost
+   * @param knowledge knowledge base, nullptr to disable
    */
-  double 
-  computePriorityScore(const PatchCandidate& patch, std::unordered_map<std::string, std::vector<FreqEntry>>& freqMap) const;
+  void setKnowledgeBase(std::shared_ptr<const KnowledgeBase> knowledge) { knowledge_ = std::move(knowledge); }
 
   /**
-   * @brief generate reasoning for the priority score
-   * @param features extracted features
-   * @param score computed priority score
-   * @return reasoning string
+   * @brief how strongly the validation queue interleaves locations and
+   * operator families, 0 keeps the score order
    */
-  std::string 
-  generateReasoning(const std::vector<std::string> &features,
-                                double score) const;
+  void setDiversity(double diversity) { diversity_ = diversity; }
+
+private:
+  std::shared_ptr<const FrequencyModel> frequencies_;
+  RankingModel ranking_ = RankingModel::product();
+  double diversity_ = 1.0;
+  std::shared_ptr<const KnowledgeBase> knowledge_;
+  size_t num_threads_ = 0;
 
   /**
-   * @brief extract frequencies from data file
-   * @param freqFile frequency file to parse
-   * @return unordered map with mutations as keys and vector of frequency entries as values
+   * @brief whether a candidate has a non-zero similarity, suspiciousness
+   * and frequency, the others are cut like a zero product always was
    */
-  std::unordered_map<std::string, std::vector<FreqEntry>> 
-  parseFrequencyFile(const std::string& freqFile) const;
+  static bool hasEvidence(const PatchCandidate& patch, const FrequencyModel& frequencies);
 };
 
 } // namespace apr_system
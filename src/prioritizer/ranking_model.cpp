@@ -0,0 +1,244 @@
+#include "ranking_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+
+namespace apr_system {
+
+namespace {
+
+constexpr std::array<std::string_view, FeatureMatrix::kFeatures> kFeatureNames = {
+    "log_similarity",
+    "log_suspiciousness",
+    "log_frequency",
+    "genealogy_similarity",
+    "dependency_similarity",
+    "replacement",
+    "insertion",
+    "deletion",
+    "operator",
+    "expression_target",
+    "statement_target",
+    "same_node_type",
+    "failing_line_distance",
+    "ingredient_same_file",
+    "ingredient_line_distance",
+};
+
+// rows scored together, a batch of the score array stays in L1 while the columns stream past
+constexpr size_t kBatch = 256;
+
+// log of scores that are positive but tiny, zero scores never reach the model
+constexpr double kLogFloor = 1e-12;
+
+// keeps exp() finite for far out trained models
+constexpr double kMaxLogit = 700.0;
+
+double safe_log(double x) {
+    return std::log(std::max(x, kLogFloor));
+}
+
+double line_distance(int a, int b) {
+    return std::log1p(std::abs(a - b));
+}
+
+bool is_expression(std::string_view type) {
+    return type.ends_with("_expression") || type.ends_with("identifier") || type.ends_with("_literal");
+}
+
+bool is_statement(std::string_view type) {
+    return type.ends_with("_statement") || type.ends_with("declaration");
+}
+
+double sigmoid(double z) {
+    return 1.0 / (1.0 + std::exp(-z));
+}
+
+} // namespace
+
+std::string_view FeatureMatrix::name(size_t feature) {
+    return kFeatureNames.at(feature);
+}
+
+FeatureMatrix FeatureMatrix::extract(std::span<const PatchCandidate> candidates, const FrequencyModel &frequencies) {
+    FeatureMatrix m;
+    m.rows = candidates.size();
+    for (auto &column : m.columns) column.assign(m.rows, 0.0);
+    m.product.resize(m.rows);
+
+    for (size_t i = 0; i < m.rows; ++i) {
+        const PatchCandidate &p = candidates[i];
+        const MutationType &type = p.mutation_type;
+        const double frequency = frequencies.lookup(type);
+        m.product[i] = p.similarity_score * p.suspiciousness_score * frequency;
+        m.columns[LogSimilarity][i] = safe_log(p.similarity_score);
+        m.columns[LogSuspiciousness][i] = safe_log(p.suspiciousness_score);
+        m.columns[LogFrequency][i] = safe_log(frequency);
+        m.columns[GenealogySimilarity][i] = p.genealogy_similarity;
+        m.columns[DependencySimilarity][i] = p.dependency_similarity;
+        if (auto category = FrequencyModel::categoryOf(type.mutation_category)) {
+            m.columns[Replacement + static_cast<size_t>(*category)][i] = 1.0;
+        }
+        m.columns[ExpressionTarget][i] = is_expression(type.target_node);
+        m.columns[StatementTarget][i] = is_statement(type.target_node);
+        m.columns[SameNodeType][i] = type.source_node == type.target_node;
+        if (p.suspicious_line > 0) {
+            m.columns[FailingLineDistance][i] = line_distance(p.start_line, p.suspicious_line);
+        }
+        if (!p.ingredient_file.empty() && p.ingredient_file == p.file_path) {
+            m.columns[IngredientSameFile][i] = 1.0;
+            m.columns[IngredientLineDistance][i] = line_distance(p.ingredient_line, p.start_line);
+        }
+    }
+    return m;
+}
+
+RankingModel RankingModel::product() {
+    RankingModel model;
+    model.weights_[FeatureMatrix::LogSimilarity] = 1.0;
+    model.weights_[FeatureMatrix::LogSuspiciousness] = 1.0;
+    model.weights_[FeatureMatrix::LogFrequency] = 1.0;
+    model.plain_product_ = true;
+    return model;
+}
+
+RankingModel RankingModel::load(const std::string &path) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        throw std::runtime_error("failed to open ranking model: " + path);
+    }
+    RankingModel model;
+    try {
+        const nlohmann::json data = nlohmann::json::parse(in);
+        model.bias_ = data.value("bias", 0.0);
+        for (const auto &[name, weight] : data.at("weights").items()) {
+            const auto it = std::find(kFeatureNames.begin(), kFeatureNames.end(), name);
+            if (it == kFeatureNames.end()) {
+                throw std::runtime_error("unknown feature '" + name + "'");
+            }
+            model.weights_[it - kFeatureNames.begin()] = weight.get<double>();
+        }
+    } catch (const std::exception &e) {
+        throw std::runtime_error("failed to parse ranking model " + path + ": " + e.what());
+    }
+    return model;
+}
+
+void RankingModel::save(const std::string &path) const {
+    nlohmann::json weights = nlohmann::json::object();
+    for (size_t f = 0; f < FeatureMatrix::kFeatures; ++f) {
+        weights[std::string(kFeatureNames[f])] = weights_[f];
+    }
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        throw std::runtime_error("failed to write ranking model: " + path);
+    }
+    out << nlohmann::json{{"bias", bias_}, {"weights", weights}}.dump(2) << '\n';
+}
+
+void RankingModel::linear(const FeatureMatrix &features, std::span<double> out) const {
+    for (size_t begin = 0; begin < features.rows; begin += kBatch) {
+        const size_t end = std::min(features.rows, begin + kBatch);
+        double *z = out.data();
+        std::fill(z + begin, z + end, bias_);
+        for (size_t f = 0; f < FeatureMatrix::kFeatures; ++f) {
+            const double w = weights_[f];
+            if (w == 0.0) continue;
+            const double *column = features.columns[f].data();
+            // plain axpy over contiguous doubles, the compiler vectorizes it
+            for (size_t i = begin; i < end; ++i) z[i] += w * column[i];
+        }
+    }
+}
+
+void RankingModel::score(const FeatureMatrix &features, std::span<double> scores) const {
+    if (plain_product_) {
+        std::copy(features.product.begin(), features.product.end(), scores.begin());
+        return;
+    }
+    linear(features, scores);
+    for (size_t i = 0; i < features.rows; ++i) {
+        scores[i] = std::exp(std::clamp(scores[i], -kMaxLogit, kMaxLogit));
+    }
+}
+
+RankingModel RankingModel::train(const FeatureMatrix &features, const std::vector<bool> &plausible,
+                                 size_t epochs, double learning_rate, double l2) {
+    if (plausible.size() != features.rows) {
+        throw std::invalid_argument("one label per feature row expected");
+    }
+    const RankingModel prior = product();
+    if (features.rows == 0) return prior;
+    const double n = static_cast<double>(features.rows);
+
+    // gradient descent runs on standardized columns, the log features span very different ranges
+    std::array<double, FeatureMatrix::kFeatures> mean{}, scale{};
+    for (size_t f = 0; f < FeatureMatrix::kFeatures; ++f) {
+        const auto &column = features.columns[f];
+        double sum = 0.0, sq = 0.0;
+        for (double x : column) {
+            sum += x;
+            sq += x * x;
+        }
+        mean[f] = sum / n;
+        const double var = std::max(0.0, sq / n - mean[f] * mean[f]);
+        scale[f] = var > 1e-12 ? std::sqrt(var) : 0.0; // constant columns carry no signal
+    }
+
+    // the prior in standardized coordinates, weight decay pulls towards it
+    RankingModel model;
+    model.bias_ = prior.bias_;
+    for (size_t f = 0; f < FeatureMatrix::kFeatures; ++f) {
+        model.weights_[f] = prior.weights_[f] * scale[f];
+        model.bias_ += prior.weights_[f] * mean[f];
+    }
+    const RankingModel start = model;
+
+    FeatureMatrix standardized;
+    standardized.rows = features.rows;
+    for (size_t f = 0; f < FeatureMatrix::kFeatures; ++f) {
+        standardized.columns[f].resize(features.rows);
+        for (size_t i = 0; i < features.rows; ++i) {
+            standardized.columns[f][i] = scale[f] > 0.0 ? (features.columns[f][i] - mean[f]) / scale[f] : 0.0;
+        }
+    }
+
+    std::vector<double> residual(features.rows);
+    for (size_t epoch = 0; epoch < epochs; ++epoch) {
+        model.linear(standardized, residual);
+        double bias_gradient = 0.0;
+        for (size_t i = 0; i < features.rows; ++i) {
+            residual[i] = sigmoid(residual[i]) - (plausible[i] ? 1.0 : 0.0);
+            bias_gradient += residual[i];
+        }
+        model.bias_ -= learning_rate * bias_gradient / n;
+        for (size_t f = 0; f < FeatureMatrix::kFeatures; ++f) {
+            if (scale[f] == 0.0) continue;
+            const double *column = standardized.columns[f].data();
+            double gradient = 0.0;
+            for (size_t i = 0; i < features.rows; ++i) gradient += residual[i] * column[i];
+            gradient = gradient / n + l2 * (model.weights_[f] - start.weights_[f]);
+            model.weights_[f] -= learning_rate * gradient;
+        }
+    }
+
+    // back to raw feature coordinates
+    RankingModel trained;
+    trained.bias_ = model.bias_;
+    for (size_t f = 0; f < FeatureMatrix::kFeatures; ++f) {
+        if (scale[f] == 0.0) {
+            trained.weights_[f] = prior.weights_[f];
+            trained.bias_ -= prior.weights_[f] * mean[f];
+            continue;
+        }
+        trained.weights_[f] = model.weights_[f] / scale[f];
+        trained.bias_ -= trained.weights_[f] * mean[f];
+    }
+    return trained;
+}
+
+} // namespace apr_system
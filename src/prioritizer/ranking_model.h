@@ -0,0 +1,123 @@
+#pragma once
+
+#include "../core/frequency_model.h"
+#include "../core/types.h"
+#include <array>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace apr_system {
+
+/**
+ * @brief fixed-width numeric features of patch candidates, one column per
+ * feature (structure of arrays) so scoring streams over contiguous memory
+ */
+struct FeatureMatrix {
+  enum Feature : size_t {
+    LogSimilarity,
+    LogSuspiciousness,
+    LogFrequency,
+    GenealogySimilarity,
+    DependencySimilarity,
+    Replacement,
+    Insertion,
+    Deletion,
+    Operator,
+    ExpressionTarget,
+    StatementTarget,
+    SameNodeType,
+    FailingLineDistance,
+    IngredientSameFile,
+    IngredientLineDistance,
+  };
+  static constexpr size_t kFeatures = 15;
+
+  /**
+   * @brief name of a feature as used in model files
+   */
+  static std::string_view name(size_t feature);
+
+  /**
+   * @brief extract the features of candidates
+   * @param candidates candidates to describe, one row each
+   * @param frequencies historical frequencies for LogFrequency
+   */
+  static FeatureMatrix extract(std::span<const PatchCandidate> candidates,
+                               const FrequencyModel &frequencies);
+
+  size_t rows = 0;
+  std::array<std::vector<double>, kFeatures> columns;
+  // similarity × suspiciousness × frequency of every row, not a model input
+  std::vector<double> product;
+};
+
+/**
+ * @brief linear patch-ranking model over FeatureMatrix
+ *
+ * a candidate's score is exp(bias + weights · features). the default model
+ * puts weight 1 on the three log features, which ranks like similarity ×
+ * suspiciousness × frequency, the product the prioritizer always used; it
+ * scores that product directly, since going through exp and log would be
+ * off by a few ulps and reorder ties. trained models are logistic
+ * regressions on past validation outcomes, so their score is the odds that
+ * the candidate is plausible.
+ */
+class RankingModel {
+public:
+  /**
+   * @brief the similarity × suspiciousness × frequency product
+   */
+  static RankingModel product();
+
+  /**
+   * @brief load a model file
+   *
+   * json of the form {"bias": b, "weights": {"<feature name>": w, ...}},
+   * features a file does not mention get weight 0.
+   *
+   * @throws std::runtime_error if the file cannot be read, parsed or names
+   * an unknown feature
+   */
+  static RankingModel load(const std::string &path);
+
+  /**
+   * @brief write the model in the format load() reads
+   * @throws std::runtime_error if the file cannot be written
+   */
+  void save(const std::string &path) const;
+
+  /**
+   * @brief fit a logistic regression by batch gradient descent
+   * @param features one row per validated candidate
+   * @param plausible per row, whether the candidate passed all tests
+   * @param epochs gradient steps
+   * @param learning_rate step size
+   * @param l2 weight decay, pulls weights towards the product model's
+   */
+  static RankingModel train(const FeatureMatrix &features, const std::vector<bool> &plausible,
+                            size_t epochs = 500, double learning_rate = 0.1, double l2 = 1e-3);
+
+  /**
+   * @brief score every row, in batches of contiguous columns
+   * @param features candidates to score
+   * @param scores output, features.rows entries
+   */
+  void score(const FeatureMatrix &features, std::span<double> scores) const;
+
+  double bias() const { return bias_; }
+  double weight(size_t feature) const { return weights_[feature]; }
+
+private:
+  // linear predictor bias + weights · features of every row
+  void linear(const FeatureMatrix &features, std::span<double> out) const;
+
+  double bias_ = 0.0;
+  std::array<double, FeatureMatrix::kFeatures> weights_{};
+  // product() model, scores FeatureMatrix::product as is
+  bool plain_product_ = false;
+};
+
+} // namespace apr_system
@@ -1,6 +1,5 @@
 #include "utils.h"
 #include <iostream>
-#include <fstream>
 
 namespace apr_system {
 
@@ -29,25 +28,4 @@ void printPrioritizedPatches(const std::vector<PrioritizedPatch>& patches) {
     }
 }
 
-void dumpPrioritizedPatchesToFile(const std::vector<PatchCandidate>& patches) {
-    std::ofstream fout("Prioritized_Patches.txt");
-    if (!fout.is_open()) return;
-    int count = 1;
-    for (const auto &p : patches) {
-        fout 
-          << "patch #: " << count << "\n"
-          << "node_id: " << p.target_node_id << "\n"
-          << "similarity_score: "<< p.similarity_score << "\n"
-          << "priority_score: " << p.priority_score << "\n"
-          << "mutation_type: " << p.mutation_type.mutation_category
-          << " (target=" << p.mutation_type.target_node
-          << ", source=" << p.mutation_type.source_node << ")\n"
-          << "lines: [" << p.start_line << "-" << p.end_line << "]\n"
-          << "Original: " << p.original_code << "\n"
-          << "Modified: " << p.modified_code << "\n"
-          << "Diff:\n" << p.diff << "\n\n";
-        ++count;
-    }
-}
-
 } // namespace apr_system
\ No newline at end of file
@@ -13,7 +13,4 @@ void printFreqMap(
 // Console debug dump of PrioritizedPatch objects
 void printPrioritizedPatches(const std::vector<PrioritizedPatch>& patches);
 
-// File dump of PatchCandidate list to "Prioritized_Patches.txt"
-void dumpPrioritizedPatchesToFile(const std::vector<PatchCandidate>& patches);
-
 } // namespace apr_system
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "validation_queue.h"
+
+#include <algorithm>
+
+namespace apr_system {
+
+AdaptiveValidationQueue::AdaptiveValidationQueue(const std::vector<PatchCandidate> &patch_candidates,
+                                                 const std::vector<RankedPatch> &prioritized_patches,
+                                                 double diversity, double prior_strength)
+    : candidates_(patch_candidates), ranking_(prioritized_patches), diversity_(diversity),
+      prior_strength_(prior_strength) {
+    // Helper, dense id of a key, adding a fresh posterior for new keys
+    auto intern = [](std::unordered_map<std::string, size_t> &ids, std::vector<Posterior> &posteriors,
+                     std::string key) {
+        auto [it, inserted] = ids.try_emplace(std::move(key), posteriors.size());
+        if (inserted) posteriors.emplace_back();
+        return it->second;
+    };
+
+    std::unordered_map<std::string, size_t> family_ids;
+    std::unordered_map<size_t, size_t> group_ids; // location * ranking size + op -> group
+    for (size_t pos = 0; pos < ranking_.size(); ++pos) {
+        const PatchCandidate &patch = candidates_[ranking_[pos].candidate];
+        const size_t location = intern(location_ids_, locations_, locationKey(patch));
+        const size_t op = intern(operator_ids_, operators_, operatorKey(patch));
+        const size_t key = location * ranking_.size() + op;
+        auto [it, inserted] = group_ids.try_emplace(key, groups_.size());
+        if (inserted) {
+            const size_t family = family_ids.try_emplace(familyKey(patch), family_ids.size()).first->second;
+            groups_.push_back({location, op, family, {}, 0});
+        }
+        groups_[it->second].positions.push_back(pos);
+        group_of_[ranking_[pos].candidate] = it->second;
+    }
+    location_picks_.assign(locations_.size(), 0);
+    family_picks_.assign(family_ids.size(), 0);
+}
+
+std::string AdaptiveValidationQueue::locationKey(const PatchCandidate &patch) {
+    return patch.file_path + ":" + std::to_string(patch.start_line);
+}
+
+std::string AdaptiveValidationQueue::operatorKey(const PatchCandidate &patch) {
+    const MutationType &type = patch.mutation_type;
+    return type.mutation_category + ":" + type.target_node + ":" + type.source_node;
+}
+
+std::string AdaptiveValidationQueue::familyKey(const PatchCandidate &patch) {
+    const MutationType &type = patch.mutation_type;
+    // operator mutations name their class (boundary, logical, ...) as the source
+    return type.mutation_category == "Operator" ? type.mutation_category + ":" + type.source_node
+                                                : type.mutation_category;
+}
+
+double AdaptiveValidationQueue::mean(const Posterior &posterior) const {
+    return (posterior.hits + prior_strength_ / 2) / (posterior.hits + posterior.misses + prior_strength_);
+}
+
+double AdaptiveValidationQueue::locationMean(const PatchCandidate &patch) const {
+    auto it = location_ids_.find(locationKey(patch));
+    return it == location_ids_.end() ? mean({}) : mean(locations_[it->second]);
+}
+
+double AdaptiveValidationQueue::operatorMean(const PatchCandidate &patch) const {
+    auto it = operator_ids_.find(operatorKey(patch));
+    return it == operator_ids_.end() ? mean({}) : mean(operators_[it->second]);
+}
+
+double AdaptiveValidationQueue::reward(const ValidationResult &result) {
+    if (!result.compilation_success) return 0.0;
+    if (result.tests_passed) return 1.0;
+    // compiling is worth half, the other half grows with the share of tests that pass
+    if (result.tests_total_count <= 0) return 0.5;
+    const double passed = std::clamp(
+        static_cast<double>(result.tests_passed_count) / result.tests_total_count, 0.0, 1.0);
+    return 0.5 + 0.5 * passed;
+}
+
+std::optional<size_t> AdaptiveValidationQueue::next() {
+    Group *best = nullptr;
+    double best_score = -1.0;
+    for (auto &group : groups_) {
+        if (group.head == group.positions.size()) continue;
+        const size_t pos = group.positions[group.head];
+        const double score = ranking_[pos].priority_score * mean(locations_[group.location]) *
+                             mean(operators_[group.op]) /
+                             (1.0 + diversity_ * static_cast<double>(location_picks_[group.location])) /
+                             (1.0 + diversity_ * static_cast<double>(family_picks_[group.family]));
+        // ties go to the better ranked candidate, so the initial order is the ranking
+        if (!best || score > best_score ||
+            (score == best_score && pos < best->positions[best->head])) {
+            best = &group;
+            best_score = score;
+        }
+    }
+    if (!best) return std::nullopt;
+    ++location_picks_[best->location];
+    ++family_picks_[best->family];
+    return ranking_[best->positions[best->head++]].candidate;
+}
+
+void AdaptiveValidationQueue::record(size_t candidate, const ValidationResult &result) {
+    auto it = group_of_.find(candidate);
+    if (it == group_of_.end()) return;
+    const Group &group = groups_[it->second];
+    const double r = reward(result);
+    for (Posterior *posterior : {&locations_[group.location], &operators_[group.op]}) {
+        posterior->hits += r;
+        posterior->misses += 1.0 - r;
+    }
+}
+
+} // namespace apr_system
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "../core/contracts.h"
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace apr_system {
+
+/**
+ * @brief validation queue re-ranked by the outcomes of earlier validations
+ *
+ * every location (file and start line) and every operator (mutation
+ * category, target and source node type) keeps a Beta posterior over how
+ * useful its candidates turn out: a compile failure counts as a miss, a
+ * compiling patch as a partial hit growing with the share of tests it
+ * passes, a plausible patch as a full hit. the next candidate is the one
+ * maximizing priority × posterior mean of its location × posterior mean
+ * of its operator, so the budget drifts towards locations and operators
+ * that produce compiling, test-improving patches.
+ *
+ * the score is further divided by 1 + diversity × (candidates already
+ * handed out at the location) and likewise for the operator family (the
+ * mutation category, or the operator class for operator mutations). this
+ * interleaves the ranking round-robin style, weighted by score, so a
+ * budget is not spent entirely on the one or two lines the ranking likes
+ * best. diversity 0 turns it off.
+ *
+ * all posteriors start at the same prior, so without diversity and until
+ * the first outcome the queue hands out the ranking unchanged. candidates
+ * sharing a location and an operator keep their ranking order among
+ * themselves; a pick scans the head of every such group, which is cheap
+ * for validation-sized rankings.
+ */
+class AdaptiveValidationQueue : public IValidationQueue {
+public:
+  /**
+   * @param patch_candidates candidates the ranking refers to, must outlive
+   * the queue
+   * @param prioritized_patches ranking to start from
+   * @param diversity penalty per candidate already handed out at the same
+   * location or in the same operator family
+   * @param prior_strength pseudo-observations of the prior, whose mean is
+   * 1/2; larger values make the queue slower to react
+   */
+  AdaptiveValidationQueue(const std::vector<PatchCandidate> &patch_candidates,
+                          const std::vector<RankedPatch> &prioritized_patches,
+                          double diversity = 1.0, double prior_strength = 2.0);
+
+  size_t size() const override { return ranking_.size(); }
+  std::optional<size_t> next() override;
+  void record(size_t candidate, const ValidationResult &result) override;
+
+  /**
+   * @brief reward of an outcome in [0, 1], see the class description
+   */
+  static double reward(const ValidationResult &result);
+
+  /**
+   * @brief posterior mean of a location, keyed like locationKey()
+   */
+  double locationMean(const PatchCandidate &patch) const;
+
+  /**
+   * @brief posterior mean of an operator, keyed like operatorKey()
+   */
+  double operatorMean(const PatchCandidate &patch) const;
+
+  static std::string locationKey(const PatchCandidate &patch);
+  static std::string operatorKey(const PatchCandidate &patch);
+  static std::string familyKey(const PatchCandidate &patch);
+
+private:
+  struct Posterior {
+    double hits = 0.0;
+    double misses = 0.0;
+  };
+
+  struct Group {
+    size_t location;
+    size_t op;
+    size_t family;
+    // positions in ranking_, in ranking order, handed out from head on
+    std::vector<size_t> positions;
+    size_t head = 0;
+  };
+
+  double mean(const Posterior &posterior) const;
+
+  const std::vector<PatchCandidate> &candidates_;
+  std::vector<RankedPatch> ranking_;
+  double diversity_;
+  double prior_strength_;
+
+  std::unordered_map<std::string, size_t> location_ids_;
+  std::unordered_map<std::string, size_t> operator_ids_;
+  std::vector<Posterior> locations_;
+  std::vector<Posterior> operators_;
+  // candidates handed out per location and per operator family
+  std::vector<size_t> location_picks_;
+  std::vector<size_t> family_picks_;
+  std::vector<Group> groups_;
+  // candidate index -> its group, for record()
+  std::unordered_map<size_t, size_t> group_of_;
+};
+
+} // namespace apr_system
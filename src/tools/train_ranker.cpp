@@ -0,0 +1,108 @@
+// offline trainer for the prioritizer's ranking model
+//
+// learns from traces of earlier runs: run apr_system with
+// --trace prioritizer,validator, then
+//
+//   apr_train_ranker [--freq-json PATH] MODEL_OUT TRACE.ndjson...
+//
+// every candidate the validator built becomes one example, labelled
+// plausible if all tests passed. pass the written model to apr_system
+// with --ranking-model.
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "core/frequency_model.h"
+#include "prioritizer/ranking_model.h"
+
+using namespace apr_system;
+
+namespace {
+
+void printUsage() {
+    std::cerr << "usage: apr_train_ranker [--freq-json PATH] MODEL_OUT TRACE.ndjson...\n";
+}
+
+// Helper, join a trace's prioritized candidates with their validation results
+void readTrace(const std::string &path, std::vector<PatchCandidate> &candidates, std::vector<bool> &plausible) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        throw std::runtime_error("failed to open trace: " + path);
+    }
+    // patch ids are only unique within one run, i.e. one trace
+    std::unordered_map<std::string, PatchCandidate> prioritized;
+    std::unordered_map<std::string, bool> validated;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        const auto record = nlohmann::json::parse(line);
+        const std::string event = record.value("event", "");
+        if (event == "prioritized") {
+            auto candidate = record.at("data").get<PatchCandidate>();
+            prioritized[candidate.patch_id] = std::move(candidate);
+        } else if (event == "result") {
+            validated[record.at("data").at("patch_id").get<std::string>()] =
+                record.at("data").at("tests_passed").get<bool>();
+        }
+    }
+    for (auto &[patch_id, passed] : validated) {
+        auto it = prioritized.find(patch_id);
+        if (it == prioritized.end()) continue;
+        candidates.push_back(std::move(it->second));
+        plausible.push_back(passed);
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::string freq_json;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--freq-json" && i + 1 < argc) {
+            freq_json = argv[++i];
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() < 2) {
+        printUsage();
+        return 1;
+    }
+
+    try {
+        auto frequencies = freq_json.empty() ? FrequencyModel::builtin() : FrequencyModel::load(freq_json);
+
+        std::vector<PatchCandidate> candidates;
+        std::vector<bool> plausible;
+        for (size_t i = 1; i < positional.size(); ++i) {
+            readTrace(positional[i], candidates, plausible);
+        }
+        size_t positives = 0;
+        for (bool p : plausible) positives += p;
+        std::cout << "training on " << candidates.size() << " validated candidates, " << positives
+                  << " plausible\n";
+        if (candidates.empty()) {
+            std::cerr << "no validated candidates in the traces, were they written with "
+                         "--trace prioritizer,validator?\n";
+            return 1;
+        }
+
+        const auto model = RankingModel::train(FeatureMatrix::extract(candidates, *frequencies), plausible);
+        model.save(positional[0]);
+        std::cout << "wrote " << positional[0] << "\n";
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "diagnostics.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <sstream>
+
+namespace apr_system {
+
+namespace {
+
+bool contains(const std::string& text, const char* needle) {
+    return text.find(needle) != std::string::npos;
+}
+
+// gcc quotes with ‘’ in UTF-8 locales, clang with plain apostrophes
+const std::string kOpenQuote = "\xE2\x80\x98";
+const std::string kCloseQuote = "\xE2\x80\x99";
+
+// Helper, the quoted names of a message in order
+std::vector<std::string> quoted_names(const std::string& message) {
+    std::vector<std::string> names;
+    size_t pos = 0;
+    while (pos < message.size()) {
+        size_t open = message.find('\'', pos);
+        size_t open_len = 1;
+        size_t fancy = message.find(kOpenQuote, pos);
+        if (fancy < open) {
+            open = fancy;
+            open_len = kOpenQuote.size();
+        }
+        if (open == std::string::npos) break;
+        const size_t begin = open + open_len;
+        size_t close = message.find('\'', begin);
+        size_t close_len = 1;
+        fancy = message.find(kCloseQuote, begin);
+        if (fancy < close) {
+            close = fancy;
+            close_len = kCloseQuote.size();
+        }
+        if (close == std::string::npos) break;
+        names.push_back(message.substr(begin, close - begin));
+        pos = close + close_len;
+    }
+    return names;
+}
+
+DiagnosticKind classify(const std::string& message) {
+    if (contains(message, "was not declared in this scope") || contains(message, "undeclared identifier") ||
+        contains(message, "no member named") || contains(message, "is not a member of")) {
+        return DiagnosticKind::Undeclared;
+    }
+    if (contains(message, "cannot convert") || contains(message, "could not convert") ||
+        contains(message, "invalid conversion") || contains(message, "no viable conversion") ||
+        contains(message, "cannot initialize") || contains(message, "invalid operands") ||
+        contains(message, "no match for") || contains(message, "no matching function") ||
+        contains(message, "incompatible")) {
+        return DiagnosticKind::TypeMismatch;
+    }
+    return DiagnosticKind::Other;
+}
+
+bool parse_number(const std::string& text, int& value) {
+    if (text.empty() || !std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return false;
+    }
+    value = std::stoi(text);
+    return true;
+}
+
+// Helper, whitespace-collapsed text so formatting differences do not split a family
+std::string collapse_whitespace(const std::string& text) {
+    std::string result;
+    bool pending_space = false;
+    for (char c : text) {
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            pending_space = !result.empty();
+            continue;
+        }
+        if (pending_space) {
+            result += ' ';
+            pending_space = false;
+        }
+        result += c;
+    }
+    return result;
+}
+
+bool mentions_identifier(const std::string& code, const std::string& name) {
+    auto is_ident = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+    for (size_t pos = code.find(name); pos != std::string::npos; pos = code.find(name, pos + 1)) {
+        const size_t end = pos + name.size();
+        if ((pos == 0 || !is_ident(code[pos - 1])) && (end == code.size() || !is_ident(code[end]))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Helper, whether a diagnostic points into the lines a patch wrote
+bool inside_patch(const CompilerDiagnostic& diagnostic, const PatchCandidate& patch) {
+    namespace fs = std::filesystem;
+    if (fs::path(diagnostic.file).filename() != fs::path(patch.file_path).filename()) return false;
+    const int written_lines = 1 + static_cast<int>(std::count(patch.modified_code.begin(), patch.modified_code.end(), '\n'));
+    return diagnostic.line >= patch.start_line && diagnostic.line < patch.start_line + written_lines;
+}
+
+} // namespace
+
+std::vector<CompilerDiagnostic> parseCompilerDiagnostics(const std::string& build_output) {
+    std::vector<CompilerDiagnostic> diagnostics;
+    std::istringstream stream(build_output);
+    std::string line;
+    while (std::getline(stream, line)) {
+        size_t marker = line.find(": error: ");
+        size_t marker_len = 9;
+        if (marker == std::string::npos) {
+            marker = line.find(": fatal error: ");
+            marker_len = 15;
+        }
+        if (marker == std::string::npos) continue;
+
+        // location is file:line:col or file:line
+        std::string location = line.substr(0, marker);
+        std::vector<std::string> parts;
+        for (int i = 0; i < 2; ++i) {
+            const size_t colon = location.rfind(':');
+            if (colon == std::string::npos) break;
+            parts.push_back(location.substr(colon + 1));
+            location.erase(colon);
+        }
+
+        CompilerDiagnostic diagnostic;
+        if (parts.size() == 2 && parse_number(parts[1], diagnostic.line) && parse_number(parts[0], diagnostic.column)) {
+            diagnostic.file = location;
+        } else if (!parts.empty() && parse_number(parts[0], diagnostic.line)) {
+            diagnostic.file = parts.size() == 2 ? location + ":" + parts[1] : location;
+        } else {
+            continue; // linker or driver error without a source location
+        }
+        diagnostic.message = line.substr(marker + marker_len);
+        if (!diagnostic.message.empty() && diagnostic.message.back() == '\r') diagnostic.message.pop_back();
+        diagnostic.kind = classify(diagnostic.message);
+
+        auto names = quoted_names(diagnostic.message);
+        if (!names.empty()) {
+            // gcc names the class first: 'class Foo' has no member named 'bar'
+            diagnostic.name = contains(diagnostic.message, "has no member named") ? names.back() : names.front();
+        }
+        diagnostics.push_back(std::move(diagnostic));
+    }
+    return diagnostics;
+}
+
+std::string CompileFailureIndex::locationKey(const PatchCandidate& patch) {
+    return patch.file_path + ":" + std::to_string(patch.start_line);
+}
+
+std::string CompileFailureIndex::ingredientKey(const PatchCandidate& patch) {
+    return patch.mutation_type.mutation_category + "\n" + collapse_whitespace(patch.modified_code);
+}
+
+bool CompileFailureIndex::record(const PatchCandidate& patch, const std::vector<CompilerDiagnostic>& diagnostics) {
+    bool recorded = false;
+    for (const auto& diagnostic : diagnostics) {
+        if (diagnostic.kind == DiagnosticKind::Other || !inside_patch(diagnostic, patch)) continue;
+        Location& location = failed_[locationKey(patch)];
+        if (diagnostic.kind == DiagnosticKind::Undeclared && !diagnostic.name.empty() &&
+            mentions_identifier(patch.modified_code, diagnostic.name)) {
+            location.undeclared_names.insert(diagnostic.name);
+        } else {
+            location.mismatched_ingredients.insert(ingredientKey(patch));
+        }
+        recorded = true;
+    }
+    return recorded;
+}
+
+bool CompileFailureIndex::covers(const PatchCandidate& patch) const {
+    auto it = failed_.find(locationKey(patch));
+    if (it == failed_.end()) return false;
+    if (it->second.mismatched_ingredients.count(ingredientKey(patch))) return true;
+    return std::any_of(it->second.undeclared_names.begin(), it->second.undeclared_names.end(),
+                       [&](const std::string& name) { return mentions_identifier(patch.modified_code, name); });
+}
+
+} // namespace apr_system
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../core/types.h"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace apr_system {
+
+enum class DiagnosticKind { Undeclared, TypeMismatch, Other };
+
+// one "file:line:col: error: message" line of gcc/clang output
+struct CompilerDiagnostic {
+  std::string file;
+  int line{0};
+  int column{0};
+  std::string message;
+  DiagnosticKind kind{DiagnosticKind::Other};
+  std::string name;  // first quoted name in the message, e.g. the undeclared identifier
+};
+
+// extract the errors (warnings and notes are skipped) from a build log
+std::vector<CompilerDiagnostic> parseCompilerDiagnostics(const std::string& build_output);
+
+// remembers candidate families that are known not to compile.
+// a family is tied to a location (file + start line) and is either
+//  - every candidate there that mentions an undeclared name, or
+//  - the same mutation of the same ingredient there, after a type mismatch.
+// only errors reported inside the patched lines count, anything else may
+// be caused by the rest of the build and evicts nothing.
+class CompileFailureIndex {
+public:
+  // record a candidate that failed to build, returns true if its
+  // diagnostics marked a family as failed
+  bool record(const PatchCandidate& patch, const std::vector<CompilerDiagnostic>& diagnostics);
+
+  // whether the candidate belongs to a family that failed before
+  bool covers(const PatchCandidate& patch) const;
+
+private:
+  struct Location {
+    std::unordered_set<std::string> undeclared_names;
+    // mutation category + normalized ingredient text
+    std::unordered_set<std::string> mismatched_ingredients;
+  };
+
+  static std::string locationKey(const PatchCandidate& patch);
+  static std::string ingredientKey(const PatchCandidate& patch);
+
+  std::unordered_map<std::string, Location> failed_;
+};
+
+} // namespace apr_system
@@ -1,4 +1,8 @@
 #include "validator.h"
+#include "diagnostics.h"
+#include "workspace.h"
+#include "../core/parallel.h"
+#include "../core/trace.h"
 #include "../core/logger.h"
 #include <fstream>
 #include <sstream>
@@ -12,6 +16,8 @@
 #include <numeric>
 #include <array>
 #include <optional>
+#include <deque>
+#include <set>
 #include <sys/wait.h>
 #include <filesystem>
 #include <sys/types.h>
@@ -23,76 +29,145 @@
 
 namespace apr_system {
 
-// RAII guard for automatic directory restoration (single-thread assumption)
-class DirectoryGuard {
-public:
-    explicit DirectoryGuard(const std::string& new_dir) : original_path_(getcwd(nullptr, 0)) {
-        if (!new_dir.empty() && new_dir != "." && chdir(new_dir.c_str()) != 0) {
-            throw std::runtime_error("Failed to change directory to: " + new_dir);
-        }
-    }
-    ~DirectoryGuard() {
-        if (original_path_) {
-            (void)chdir(original_path_);
-            free(original_path_);
-        }
+namespace {
+
+// Helper, log which patch is validated next and what it changes
+void logPatchDetails(const PatchCandidate& patch, int i, int patches_to_validate) {
+    LOG_COMPONENT_INFO("validator", "[{}] validating patch {}/{}: {} ({}:{})",
+        patch.patch_id, i + 1, patches_to_validate, patch.patch_id, patch.file_path, patch.start_line);
+    LOG_COMPONENT_DEBUG("validator",
+        "[{}] patch details: file='{}', lines {}-{}, mutation='{}' (target='{}', source='{}'), scores: susp={:.3f}, sim={:.3f}",
+        patch.patch_id,
+        patch.file_path,
+        patch.start_line,
+        patch.end_line,
+        patch.mutation_type.mutation_category,
+        patch.mutation_type.target_node,
+        patch.mutation_type.source_node,
+        patch.suspiciousness_score,
+        patch.similarity_score);
+    if (!patch.diff.empty()) {
+        LOG_COMPONENT_DEBUG("validator", "[{}] unified diff:\n{}", patch.patch_id, patch.diff);
+    } else {
+        LOG_COMPONENT_DEBUG("validator", "[{}] original -> modified:\n'{}'\n-->\n'{}'",
+            patch.patch_id, patch.original_code, patch.modified_code);
     }
-    DirectoryGuard(const DirectoryGuard&) = delete;
-    DirectoryGuard& operator=(const DirectoryGuard&) = delete;
-    DirectoryGuard(DirectoryGuard&&) = delete;
-    DirectoryGuard& operator=(DirectoryGuard&&) = delete;
-private:
-    char* original_path_;
-};
+}
+
+// Helper, directory holding this run's clones of a repository: under workspace_dir if set, otherwise a hidden
+// sibling of the repository, on its filesystem so FICLONE can share the blocks
+std::filesystem::path workspaceBase(const std::string& source_root, const std::string& workspace_dir) {
+    const std::string run = "apr-validate-" + std::to_string(::getpid());
+    if (!workspace_dir.empty()) return std::filesystem::absolute(workspace_dir) / run;
+    const auto source = std::filesystem::weakly_canonical(source_root);
+    return source.parent_path() / ("." + source.filename().string() + "." + run);
+}
+
+} // namespace
 
 std::vector<ValidationResult> Validator::validatePatches(
-    const std::vector<PatchCandidate>& prioritized_patches,
+    const std::vector<PatchCandidate>& patch_candidates,
+    IValidationQueue& queue,
     const RepositoryMetadata& repo_metadata,
     int top_k
 ) {
     const auto validation_start_time = std::chrono::high_resolution_clock::now();
+    phase_timing_ = PhaseTiming{};
+    cancelled_ = false;
+    const size_t num_workers = resolveThreadCount(static_cast<size_t>(std::max(0, config_.num_workers)));
 
-    LOG_COMPONENT_INFO("validator", "starting validation: {} patches, top-{}, budget: {}min, early_exit: {}",
-        prioritized_patches.size(), top_k, config_.time_budget_minutes, config_.enable_early_exit);
+    LOG_COMPONENT_INFO("validator", "starting validation: {} patches, top-{}, budget: {}min, early_exit: {}, workers: {}",
+        queue.size(), top_k, config_.time_budget_minutes, config_.enable_early_exit, num_workers);
 
     const auto patches_to_validate = std::min({
         top_k,
         config_.max_patches_to_validate,
-        static_cast<int>(prioritized_patches.size())
+        static_cast<int>(queue.size())
     });
 
+    // a cloned build tree holds absolute paths into the original repository and would build and test that,
+    // workers only get their own build when their commands see the clone at the repository path
+    const bool workspaces_usable = config_.mount_workspaces && Workspace::mountNamespacesAvailable();
+    if (num_workers > 1 && patches_to_validate > 1 && !workspaces_usable) {
+        LOG_COMPONENT_WARN("validator", "workers cannot see their clone at the repository path ({}), "
+            "validating in place on one worker", config_.mount_workspaces ? "mount namespaces unavailable" : "workspace mounts disabled");
+    }
+
     std::vector<ValidationResult> results;
     results.reserve(patches_to_validate);
+    // candidates taken from the queue but not validated, handed out again before the queue's next ones
+    std::deque<size_t> returned;
+    const auto take = [&]() -> std::optional<size_t> {
+        if (returned.empty()) return queue.next();
+        const size_t candidate = returned.front();
+        returned.pop_front();
+        return candidate;
+    };
 
-    for (int i = 0; i < patches_to_validate; ++i) {
-        const auto& patch = prioritized_patches[i];
+    if (num_workers > 1 && patches_to_validate > 1 && workspaces_usable) {
+        // clone for the first candidate before any worker starts, a repository that cannot be cloned
+        // (unwritable workspace directory, full disk) is validated in place instead
+        std::string first_root;
+        std::unique_ptr<Workspace> first_workspace;
+        if (const auto next = queue.next()) {
+            returned.push_back(*next);
+            first_root = resolveRepoPathForPatch(patch_candidates[*next]);
+            const auto base = workspaceBase(first_root, config_.workspace_dir);
+            try {
+                first_workspace = Workspace::clone(first_root, base / "worker-0-1");
+            } catch (const std::exception& e) {
+                LOG_COMPONENT_WARN("validator", "cannot clone the repository for the workers ({}), "
+                    "validating in place on one worker", e.what());
+                std::error_code ec;
+                std::filesystem::remove(base, ec);
+            }
+        }
+        if (first_workspace) {
+            results = validatePatchesInWorkspaces(patch_candidates, queue, repo_metadata, patches_to_validate,
+                std::min(num_workers, static_cast<size_t>(patches_to_validate)), first_root, std::move(first_workspace),
+                returned, validation_start_time);
+            if (!returned.empty()) {
+                LOG_COMPONENT_WARN("validator", "workers stopped, validating the remaining candidates in place");
+            }
+        }
+    }
+
+    // families of candidates whose build failed, their remaining members are evicted unbuilt
+    CompileFailureIndex failed_families;
+    size_t evicted = 0;
+
+    // the worker pool stops at the first plausible patch too
+    const bool found = config_.enable_early_exit &&
+        std::any_of(results.begin(), results.end(), [](const auto& result) { return result.tests_passed; });
+    while (!found && static_cast<int>(results.size()) < patches_to_validate) {
+        const auto next = take();
+        if (!next) break;
+        const auto& patch = patch_candidates[*next];
+        const int i = static_cast<int>(results.size());
 
         if (isTimeBudgetExceeded(validation_start_time)) {
             LOG_COMPONENT_WARN("validator", "time budget exceeded, stopping validation");
             break;
         }
 
-        LOG_COMPONENT_INFO("validator", "[{}] validating patch {}/{}: {} ({}:{})",
-            patch.patch_id, i + 1, patches_to_validate, patch.patch_id, patch.file_path, patch.start_line);
-        LOG_COMPONENT_DEBUG("validator",
-            "[{}] patch details: file='{}', lines {}-{}, mutation='{}' (target='{}', source='{}'), scores: susp={:.3f}, sim={:.3f}",
-            patch.patch_id,
-            patch.file_path,
-            patch.start_line,
-            patch.end_line,
-            patch.mutation_type.mutation_category,
-            patch.mutation_type.target_node,
-            patch.mutation_type.source_node,
-            patch.suspiciousness_score,
-            patch.similarity_score);
-        if (!patch.diff.empty()) {
-            LOG_COMPONENT_DEBUG("validator", "[{}] unified diff:\n{}", patch.patch_id, patch.diff);
-        } else {
-            LOG_COMPONENT_DEBUG("validator", "[{}] original -> modified:\n'{}'\n-->\n'{}'",
-                patch.patch_id, patch.original_code, patch.modified_code);
+        if (failed_families.covers(patch)) {
+            LOG_COMPONENT_DEBUG("validator", "[{}] evicted, same compile error as an earlier candidate at {}:{}",
+                patch.patch_id, patch.file_path, patch.start_line);
+            ++evicted;
+            continue;
         }
 
-        auto result = validatePatchTwoPhase(patch, repo_metadata, validation_start_time);
+        logPatchDetails(patch, i, patches_to_validate);
+
+        auto result = validatePatchTwoPhase(patch, resolveRepoPathForPatch(patch), repo_metadata, validation_start_time);
+        if (!result.compilation_success &&
+            failed_families.record(patch, parseCompilerDiagnostics(result.build_output))) {
+            LOG_COMPONENT_INFO("validator", "[{}] compile error inside the patch, evicting its family", patch.patch_id);
+        }
+        if (Trace::enabled(Trace::Stage::Validator)) {
+            Trace::emit(Trace::Stage::Validator, "result", result);
+        }
+        queue.record(*next, result);
         results.emplace_back(std::move(result));
 
         if (config_.enable_early_exit && results.back().tests_passed) {
@@ -102,8 +177,8 @@ std::vector<ValidationResult> Validator::validatePatches(
     }
 
     recordTotalValidationTime(validation_start_time);
-    LOG_COMPONENT_INFO("validator", "validation completed: {}ms, {} results",
-        phase_timing_.total_time_ms, results.size());
+    LOG_COMPONENT_INFO("validator", "validation completed: {}ms, {} results, {} candidates evicted without building",
+        phase_timing_.total_time_ms, results.size(), evicted);
 
     // Clear any cached originals to avoid stale state between runs
     original_file_cache_.clear();
@@ -111,17 +186,197 @@ std::vector<ValidationResult> Validator::validatePatches(
     return results;
 }
 
+std::vector<ValidationResult> Validator::validatePatchesInWorkspaces(
+    const std::vector<PatchCandidate>& patch_candidates,
+    IValidationQueue& queue,
+    const RepositoryMetadata& repo_metadata,
+    int patches_to_validate,
+    size_t num_workers,
+    const std::string& first_root,
+    std::unique_ptr<Workspace> first_workspace,
+    std::deque<size_t>& returned,
+    const std::chrono::high_resolution_clock::time_point& validation_start_time
+) {
+    // only reached with usable mount namespaces, see validatePatches
+    LOG_COMPONENT_INFO("validator", "validating on {} workers, each in a private clone of the repository "
+        "that its commands see at the repository path (private mount namespaces)", num_workers);
+    std::vector<ValidationResult> results;
+    results.reserve(patches_to_validate);
+    CompileFailureIndex failed_families;
+    size_t evicted = 0;
+    int in_flight = 0;
+    // the first plausible patch is applied to the original repository, like the in-place flow leaves it
+    bool kept = false;
+    // directories the workers' clones are created in, removed at the end
+    std::set<std::filesystem::path> workspace_bases = {first_workspace->root().parent_path()};
+    // guards the queue, returned, failed_families, results, workspace_bases and the counters above
+    std::mutex mutex;
+
+    parallelFor(num_workers, num_workers, [&](size_t, size_t worker) {
+        // original repository root -> this worker's clone of it
+        std::unordered_map<std::string, std::unique_ptr<Workspace>> workspaces;
+        if (worker == 0) {
+            std::lock_guard<std::mutex> lock(mounts_mutex_);
+            mounted_workspaces_[first_workspace->root().string()] = first_workspace.get();
+            workspaces[first_root] = std::move(first_workspace);
+        }
+        while (true) {
+            size_t candidate = 0;
+            int i = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (cancelled_ || static_cast<int>(results.size()) + in_flight >= patches_to_validate) break;
+                std::optional<size_t> next;
+                if (returned.empty()) {
+                    next = queue.next();
+                } else {
+                    next = returned.front();
+                    returned.pop_front();
+                }
+                if (!next) break;
+                const auto& patch = patch_candidates[*next];
+                if (failed_families.covers(patch)) {
+                    LOG_COMPONENT_DEBUG("validator", "[{}] evicted, same compile error as an earlier candidate at {}:{}",
+                        patch.patch_id, patch.file_path, patch.start_line);
+                    ++evicted;
+                    continue;
+                }
+                candidate = *next;
+                i = static_cast<int>(results.size()) + in_flight++;
+            }
+            const auto& patch = patch_candidates[candidate];
+
+            if (isTimeBudgetExceeded(validation_start_time)) {
+                LOG_COMPONENT_WARN("validator", "time budget exceeded, stopping validation");
+                std::lock_guard<std::mutex> lock(mutex);
+                --in_flight;
+                break;
+            }
+            logPatchDetails(patch, i, patches_to_validate);
+
+            const std::string source_root = resolveRepoPathForPatch(patch);
+            ValidationResult result;
+            PatchCandidate local = patch;
+            Workspace* workspace = nullptr;
+            try {
+                auto& slot = workspaces[source_root];
+                if (!slot) {
+                    const auto base = workspaceBase(source_root, config_.workspace_dir);
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        workspace_bases.insert(base);
+                    }
+                    const auto root = base / ("worker-" + std::to_string(worker) + "-" + std::to_string(workspaces.size()));
+                    slot = Workspace::clone(source_root, root);
+                    LOG_COMPONENT_INFO("validator", "worker {}: cloned {} into {} ({} reflinked, {} hardlinked, {} copied files)",
+                        worker, slot->source().string(), slot->root().string(), slot->reflinked(), slot->hardlinked(), slot->copied());
+                    std::lock_guard<std::mutex> lock(mounts_mutex_);
+                    mounted_workspaces_[slot->root().string()] = slot.get();
+                }
+                workspace = slot.get();
+                local.file_path = workspace->relative(patch.file_path).string();
+                result = validatePatchTwoPhase(local, workspace->root().string(), repo_metadata, validation_start_time);
+                adoptArtifacts(result, source_root);
+            } catch (const std::exception& e) {
+                // the candidate goes back to the other workers, or to the in-place flow once all stopped
+                LOG_COMPONENT_ERROR("validator", "worker {} stopped: {}", worker, e.what());
+                std::lock_guard<std::mutex> lock(mutex);
+                --in_flight;
+                returned.push_front(candidate);
+                break;
+            }
+            if (result.tests_passed) {
+                // PHASE B leaves a plausible patch applied, the workspace serves the next candidate
+                restoreOriginalCode(local, workspace->root().string());
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            --in_flight;
+            if (cancelled_ && !result.tests_passed) {
+                LOG_COMPONENT_DEBUG("validator", "[{}] cancelled, another worker found a plausible patch", patch.patch_id);
+                break;
+            }
+            if (!result.compilation_success &&
+                failed_families.record(patch, parseCompilerDiagnostics(result.build_output))) {
+                LOG_COMPONENT_INFO("validator", "[{}] compile error inside the patch, evicting its family", patch.patch_id);
+            }
+            if (result.tests_passed && !kept && (kept = applyPatch(patch, source_root))) {
+                LOG_COMPONENT_INFO("validator", "[{}] keeping patch applied in {}", patch.patch_id, source_root);
+            }
+            if (Trace::enabled(Trace::Stage::Validator)) {
+                Trace::emit(Trace::Stage::Validator, "result", result);
+            }
+            queue.record(candidate, result);
+            results.emplace_back(std::move(result));
+
+            if (config_.enable_early_exit && results.back().tests_passed) {
+                if (!cancelled_.exchange(true)) {
+                    LOG_COMPONENT_INFO("validator", "[{}] early exit, found plausible patch, cancelling the other workers [SUCCESS]",
+                        results.back().patch_id);
+                }
+                break;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mounts_mutex_);
+        for (const auto& [source, workspace] : workspaces) {
+            if (workspace) mounted_workspaces_.erase(workspace->root().string());
+        }
+    });
+
+    cancelled_ = false;
+    for (const auto& base : workspace_bases) {
+        std::error_code ec;
+        std::filesystem::remove_all(base, ec);
+    }
+    LOG_COMPONENT_INFO("validator", "{} candidates evicted without building", evicted);
+    return results;
+}
+
+const Workspace* Validator::mountedWorkspaceFor(const std::string& working_dir) {
+    std::lock_guard<std::mutex> lock(mounts_mutex_);
+    if (mounted_workspaces_.empty()) return nullptr;
+    const auto dir = std::filesystem::absolute(working_dir).lexically_normal();
+    for (const auto& [root, workspace] : mounted_workspaces_) {
+        const auto rel = dir.lexically_relative(root);
+        if (!rel.empty() && *rel.begin() != "..") return workspace;
+    }
+    return nullptr;
+}
+
+void Validator::adoptArtifacts(ValidationResult& result, const std::string& repo_root) {
+    const auto artifact_dir = std::filesystem::absolute(std::filesystem::path(repo_root) / "artifacts" / "gtest");
+    for (std::string* path : {&result.phase_a_artifact_path, &result.phase_b_artifact_path}) {
+        std::error_code ec;
+        if (path->empty() || !std::filesystem::exists(*path, ec)) continue;
+        std::filesystem::create_directories(artifact_dir, ec);
+        const auto target = artifact_dir / std::filesystem::path(*path).filename();
+        std::filesystem::rename(*path, target, ec);
+        if (ec) {
+            // rename does not cross filesystems
+            ec.clear();
+            std::filesystem::copy_file(*path, target, std::filesystem::copy_options::overwrite_existing, ec);
+        }
+        if (ec) {
+            LOG_COMPONENT_WARN("validator", "failed to keep test artifact '{}': {}", *path, ec.message());
+            continue;
+        }
+        *path = target.string();
+    }
+}
+
 void Validator::recordTotalValidationTime(const std::chrono::high_resolution_clock::time_point& start_time) {
     const auto end_time = std::chrono::high_resolution_clock::now();
     phase_timing_.total_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
 }
 
 ValidationResult Validator::validatePatchTwoPhase(const PatchCandidate& patch,
+                                                  const std::string& repo_root,
                                                   const RepositoryMetadata& repo_metadata,
                                                   const std::chrono::high_resolution_clock::time_point& validation_start_time) {
     LOG_COMPONENT_INFO("validator", "[{}] PHASE A: validating against originally failing tests", patch.patch_id);
     auto phase_a_result = timedValidation([&]() {
-        return validateFailingTests(patch, repo_metadata, validation_start_time);
+        return validateFailingTests(patch, repo_root, repo_metadata, validation_start_time);
     }, phase_timing_.phase_a_time_ms);
 
     if (!phase_a_result.compilation_success || !phase_a_result.tests_passed) {
@@ -129,11 +384,19 @@ ValidationResult Validator::validatePatchTwoPhase(const PatchCandidate& patch,
         return phase_a_result;
     }
 
+    // PHASE A leaves a passing patch applied and built, PHASE B reuses both
+    if (patch.affected_tests.empty()) {
+        LOG_COMPONENT_INFO("validator", "[{}] PHASE A ran the full suite, PHASE B has nothing left to run, patch is plausible",
+            patch.patch_id);
+        LOG_COMPONENT_INFO("validator", "[{}] keeping patch applied (regression tests passed)", patch.patch_id);
+        return phase_a_result;
+    }
+
     LOG_COMPONENT_INFO("validator", "[{}] PHASE A passed, running PHASE B", patch.patch_id);
-    LOG_COMPONENT_INFO("validator", "[{}] PHASE B: running full regression test suite", patch.patch_id);
+    LOG_COMPONENT_INFO("validator", "[{}] PHASE B: running the regression tests PHASE A did not run", patch.patch_id);
 
     auto phase_b_result = timedValidation([&]() {
-        return validateRegressionTests(patch, repo_metadata, phase_a_result, validation_start_time);
+        return validateRegressionTests(patch, repo_root, repo_metadata, phase_a_result, validation_start_time);
     }, phase_timing_.phase_b_time_ms);
 
     if (phase_b_result.tests_passed) {
@@ -150,11 +413,13 @@ ValidationResult Validator::timedValidation(ValidationFunc&& func, long long& ti
     const auto start = std::chrono::high_resolution_clock::now();
     auto result = std::forward<ValidationFunc>(func)();
     const auto end = std::chrono::high_resolution_clock::now();
+    std::lock_guard<std::mutex> lock(timing_mutex_);
     timing_accumulator += std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
     return result;
 }
 
 ValidationResult Validator::validateFailingTests(const PatchCandidate& patch,
+                                                 const std::string& repo_root,
                                                  const RepositoryMetadata& repo_metadata,
                                                  const std::chrono::high_resolution_clock::time_point& validation_start_time) {
     ValidationResult result{
@@ -172,7 +437,6 @@ ValidationResult Validator::validateFailingTests(const PatchCandidate& patch,
         .phase_b_artifact_path = ""
     };
 
-    const std::string repo_root = resolveRepoPathForPatch(patch);
 
     try {
         LOG_COMPONENT_INFO("validator", "[{}] PHASE A step 1: applying patch", patch.patch_id);
@@ -271,8 +535,13 @@ ValidationResult Validator::validateFailingTests(const PatchCandidate& patch,
 
     } catch (const std::exception& e) {
         result.error_message = "Exception during validation: " + std::string(e.what());
+        result.tests_passed = false;
     }
 
+    // a passing patch stays applied and built for PHASE B
+    if (result.tests_passed) {
+        return result;
+    }
     bool restore_success = restoreOriginalCode(patch, repo_root);
     if (!restore_success) {
         LOG_COMPONENT_ERROR("validator", "failed to restore original code for patch");
@@ -285,61 +554,14 @@ ValidationResult Validator::validateFailingTests(const PatchCandidate& patch,
 }
 
 ValidationResult Validator::validateRegressionTests(const PatchCandidate& patch,
+                                                    const std::string& repo_root,
                                                     const RepositoryMetadata& repo_metadata,
                                                     const ValidationResult& phase_a_result,
                                                     const std::chrono::high_resolution_clock::time_point& validation_start_time) {
     ValidationResult result = phase_a_result;
-    const std::string repo_root = resolveRepoPathForPatch(patch);
 
     try {
-        if (!applyPatch(patch, repo_root)) {
-            result.error_message = "Failed to re-apply patch for PHASE B";
-            result.tests_passed = false;
-            return result;
-        }
-
-        if (isTimeBudgetExceeded(validation_start_time)) {
-            result.error_message = "Time budget exceeded during Phase B build";
-            result.tests_passed = false;
-            restoreOriginalCode(patch, repo_root);
-            return result;
-        }
-
-        // choose build working directory for phase B as well
-        std::string build_workdir_b = repo_root;
-        if (repo_metadata.test_script.find("ctest") != std::string::npos) {
-            auto looks_like_ctest_dir_b = [](const std::filesystem::path& p) -> bool {
-                std::error_code lec;
-                if (!std::filesystem::exists(p, lec) || lec) return false;
-                return std::filesystem::exists(p / "CTestTestfile.cmake", lec)
-                    || std::filesystem::exists(p / "DartConfiguration.tcl", lec)
-                    || std::filesystem::exists(p / "CTestConfig.cmake", lec)
-                    || std::filesystem::exists(p / "Testing", lec);
-            };
-            std::vector<std::filesystem::path> candidates_b;
-            candidates_b.emplace_back(repo_root);
-            candidates_b.emplace_back(std::filesystem::path(repo_root) / "build");
-            for (auto it = std::filesystem::directory_iterator(repo_root); it != std::filesystem::directory_iterator(); ++it) {
-                if (it->is_directory()) { candidates_b.emplace_back(it->path() / "build"); }
-            }
-            int max_depth_b = 3; std::error_code rec_ec_b;
-            for (auto it = std::filesystem::recursive_directory_iterator(repo_root, rec_ec_b); it != std::filesystem::recursive_directory_iterator(); ++it) {
-                if (rec_ec_b) { break; }
-                if (it.depth() > max_depth_b) { it.disable_recursion_pending(); continue; }
-                if (it->is_regular_file() && it->path().filename() == "CTestTestfile.cmake") {
-                    candidates_b.emplace_back(it->path().parent_path());
-                }
-            }
-            for (const auto& cand : candidates_b) { if (looks_like_ctest_dir_b(cand)) { build_workdir_b = cand.string(); break; } }
-        }
-        auto build_res_pair = buildProject(build_workdir_b, repo_metadata.build_script, validation_start_time);
-        if (!build_res_pair.first) {
-            result.error_message = "PHASE B compilation failed: " + build_res_pair.second;
-            result.tests_passed = false;
-            restoreOriginalCode(patch, repo_root);
-            return result;
-        }
-
+        // the patch is still applied and built from PHASE A
         if (isTimeBudgetExceeded(validation_start_time)) {
             result.error_message = "Time budget exceeded during regression tests";
             result.tests_passed = false;
@@ -348,8 +570,9 @@ ValidationResult Validator::validateRegressionTests(const PatchCandidate& patch,
         }
 
         auto test_start = std::chrono::high_resolution_clock::now();
-        TestRunResult tr = runGTests(repo_root, repo_metadata.test_script, std::vector<std::string>{},
-                                     validation_start_time, "phase-b", patch.patch_id);
+        // everything but the originally failing tests, PHASE A already ran those
+        TestRunResult tr = runGTests(repo_root, repo_metadata.test_script, patch.affected_tests,
+                                     validation_start_time, "phase-b", patch.patch_id, true);
         auto test_end = std::chrono::high_resolution_clock::now();
 
         long long regression_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(test_end - test_start).count();
@@ -416,10 +639,12 @@ bool Validator::applyPatch(const PatchCandidate& patch, const std::string& repo_
         }
 
         // snapshot original if not already cached
-        if (!original_file_cache_.count(full_file_path)) {
-            original_file_cache_[full_file_path] = *lines;
-            LOG_COMPONENT_DEBUG("validator", "[{}] cached original contents for '{}' ({} lines)",
-                patch.patch_id, full_file_path, lines->size());
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            if (original_file_cache_.emplace(full_file_path, *lines).second) {
+                LOG_COMPONENT_DEBUG("validator", "[{}] cached original contents for '{}' ({} lines)",
+                    patch.patch_id, full_file_path, lines->size());
+            }
         }
 
         if (!isValidLineRange(patch, lines->size())) {
@@ -508,9 +733,14 @@ bool Validator::restoreOriginalCode(const PatchCandidate& patch, const std::stri
             }
         }
 
-        auto it = original_file_cache_.find(full_file_path);
-        if (it != original_file_cache_.end()) {
-            const auto& orig_lines = it->second;
+        std::optional<std::vector<std::string>> cached;
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            auto it = original_file_cache_.find(full_file_path);
+            if (it != original_file_cache_.end()) cached = it->second;
+        }
+        if (cached) {
+            const auto& orig_lines = *cached;
             std::ofstream out_file(full_file_path);
             if (!out_file.is_open()) {
                 LOG_COMPONENT_ERROR("validator", "failed to open file for restoration writing");
@@ -609,7 +839,8 @@ TestRunResult Validator::runGTests(const std::string& repo_path,
                                    const std::vector<std::string>& test_filter,
                                    const std::chrono::high_resolution_clock::time_point& validation_start_time,
                                    const std::string& phase_name,
-                                   const std::string& patch_id) {
+                                   const std::string& patch_id,
+                                   bool exclude_filter) {
     TestRunResult tr;
 
     if (test_binary.empty()) {
@@ -679,14 +910,14 @@ TestRunResult Validator::runGTests(const std::string& repo_path,
 
     if (is_ctest) {
         // use CTest with junit output to our artifact path
-        // optional regex filter via -R (join test names with '|')
+        // optional regex filter via -R, or -E to exclude (join test names with '|')
         if (!test_filter.empty()) {
             std::string regex;
             for (size_t i = 0; i < test_filter.size(); ++i) {
                 if (i > 0) regex += "|";
                 regex += test_filter[i];
             }
-            command += " -R \"" + regex + "\"";
+            command += (exclude_filter ? " -E \"" : " -R \"") + regex + "\"";
         } else {
             LOG_COMPONENT_DEBUG("validator", "running full test suite");
         }
@@ -695,8 +926,10 @@ TestRunResult Validator::runGTests(const std::string& repo_path,
     } else {
         // gtest binary: use --gtest_filter and --gtest_output
         if (!test_filter.empty()) {
-            LOG_COMPONENT_DEBUG("validator", "running specific failing tests with --gtest_filter");
-            command += " --gtest_filter=";
+            LOG_COMPONENT_DEBUG("validator", "{} specific failing tests with --gtest_filter",
+                exclude_filter ? "excluding" : "running");
+            // a leading '-' turns the filter into a negative one
+            command += exclude_filter ? " --gtest_filter=-" : " --gtest_filter=";
             for (size_t i = 0; i < test_filter.size(); ++i) {
                 command += test_filter[i];
                 if (i < test_filter.size() - 1) {
@@ -760,6 +993,9 @@ ExecResult Validator::executeCommand(const std::string& command,
     fcntl(pipefd[1], F_SETFD, FD_CLOEXEC);
 #endif
 
+    // a workspace's commands run in its mount namespace, see ValidationConfig::mount_workspaces
+    const Workspace* workspace = mountedWorkspaceFor(working_dir);
+
     pid_t pid = fork();
     if (pid < 0) {
         // fork failed
@@ -774,16 +1010,22 @@ ExecResult Validator::executeCommand(const std::string& command,
         // own process group so we can kill the whole tree
         setpgid(0, 0);
 
-        // move to working_dir (best-effort)
-        if (!working_dir.empty() && working_dir != "." && chdir(working_dir.c_str()) != 0) {
-            _exit(127); // chdir failed
-        }
-
         // redirect stdout & stderr -> pipe write end
         dup2(pipefd[1], STDOUT_FILENO);
         dup2(pipefd[1], STDERR_FILENO);
         close(pipefd[0]); close(pipefd[1]);
 
+        if (workspace && !workspace->enterMountNamespace()) {
+            static const char msg[] = "[validator] failed to enter the workspace mount namespace\n";
+            (void)!write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            _exit(127);
+        }
+
+        // move to working_dir (best-effort)
+        if (!working_dir.empty() && working_dir != "." && chdir(working_dir.c_str()) != 0) {
+            _exit(127); // chdir failed
+        }
+
         // exec via sh -lc so we can pass a shell command string
         execl("/bin/sh", "sh", "-lc", command.c_str(), (char*)nullptr);
         _exit(127); // exec failed
@@ -800,6 +1042,7 @@ ExecResult Validator::executeCommand(const std::string& command,
     buffer.reserve(16 * 1024);
     const int kill_grace_ms = 5000; // after TERM, wait this long then KILL
     bool timed_out = false;
+    bool cancelled = false;
     bool child_exited = false;
     int status = 0;
 
@@ -830,10 +1073,11 @@ ExecResult Validator::executeCommand(const std::string& command,
 
         if (child_exited) break;
 
-        // handle timeout
+        // handle timeout, or another worker's early exit
         int wait_ms = time_left();
-        if (timeout_ms >= 0 && wait_ms == 0) {
-            timed_out = true;
+        cancelled = cancelled_.load();
+        if (cancelled || (timeout_ms >= 0 && wait_ms == 0)) {
+            timed_out = !cancelled;
             // send SIGTERM to the whole process group
             kill(-pid, SIGTERM);
 
@@ -890,6 +1134,9 @@ ExecResult Validator::executeCommand(const std::string& command,
     if (timed_out) {
         result.ok = false;
         result.output = "Command timed out and was terminated\n" + result.output;
+    } else if (cancelled) {
+        result.ok = false;
+        result.output = "Command cancelled, another worker found a plausible patch\n" + result.output;
     } else {
         result.ok = (result.exit_code == 0);
     }
@@ -2,7 +2,10 @@
 
 #include "../core/contracts.h"
 #include "../core/logger.h"
+#include <atomic>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <chrono>
 #include <vector>
 #include <string>
@@ -12,14 +15,29 @@
 
 namespace apr_system {
 
+class Workspace;
+
 // validation config for two-phase approach
+// num_workers > 1 validates that many patches at once, each worker in a private clone of the repository
+// (see workspace.h); 1 validates in place, 0 uses one worker per core
+// mount_workspaces runs the workers' commands in a mount namespace that shows their clone at the repository's
+// own path, so absolute paths in a copied build tree keep working. without it, or where namespaces are
+// unavailable, a clone would build the original tree and validation runs in place on one worker instead
+// workspace_dir holds the clones; empty puts them in a hidden directory next to the repository, since reflinks
+// only work within one filesystem
 struct ValidationConfig {
   int time_budget_minutes;
   int max_patches_to_validate;
   bool enable_early_exit;
-  ValidationConfig() : time_budget_minutes(70), max_patches_to_validate(100), enable_early_exit(true) {}
-  ValidationConfig(int budget_minutes, int max_patches, bool early_exit = true)
-      : time_budget_minutes(budget_minutes), max_patches_to_validate(max_patches), enable_early_exit(early_exit) {}
+  int num_workers;
+  bool mount_workspaces;
+  std::string workspace_dir;
+  ValidationConfig()
+      : time_budget_minutes(70), max_patches_to_validate(100), enable_early_exit(true), num_workers(1),
+        mount_workspaces(true) {}
+  ValidationConfig(int budget_minutes, int max_patches, bool early_exit = true, int workers = 1)
+      : time_budget_minutes(budget_minutes), max_patches_to_validate(max_patches), enable_early_exit(early_exit),
+        num_workers(workers), mount_workspaces(true) {}
 };
 
 // timing metrics for PHASE A and PHASE B execution
@@ -45,7 +63,7 @@ struct TestRunResult {
 
 // validator implements two-phase patch validation:
 // PHASE A: run only failing test cases (fast filter)
-// PHASE B: run full test suite if PHASE A passes
+// PHASE B: run the rest of the test suite on the same build if PHASE A passes
 class Validator : public IValidator {
 public:
   Validator() {}
@@ -55,8 +73,11 @@ public:
   // validate top-k patches within time budget using gtest
   // expects repo_metadata.test_script to contain path to gtest binary
   // gtest flags (--gtest_filter, --gtest_output) are added automatically
+  // candidates are pulled from the queue one at a time and every outcome is reported back to it
+  // with several workers, results are in completion order and early exit cancels the other workers' builds/tests
   virtual std::vector<ValidationResult>
-  validatePatches(const std::vector<PatchCandidate> &prioritized_patches,
+  validatePatches(const std::vector<PatchCandidate> &patch_candidates,
+                  IValidationQueue &queue,
                   const RepositoryMetadata &repo_metadata,
                   int top_k = 20);
 
@@ -70,13 +91,15 @@ public:
   const PhaseTiming& getPhaseTiming() const { return phase_timing_; }
 
 private:
-  // PHASE A: validate patch against originally failing tests only
+  // PHASE A: validate patch against originally failing tests only, a passing patch is left applied and built
   ValidationResult validateFailingTests(const PatchCandidate& patch,
+    const std::string& repo_root,
     const RepositoryMetadata& repo_metadata,
     const std::chrono::high_resolution_clock::time_point& validation_start_time);
 
-  // PHASE B: validate patch against full regression test suite
+  // PHASE B: validate the patch PHASE A left built against the rest of the regression test suite
   ValidationResult validateRegressionTests(const PatchCandidate& patch,
+    const std::string& repo_root,
     const RepositoryMetadata& repo_metadata,
     const ValidationResult& phase_a_result,
     const std::chrono::high_resolution_clock::time_point& validation_start_time);
@@ -91,12 +114,14 @@ private:
 
 
   // run gtest with optional filtering for specific test cases and time budget
+  // exclude_filter runs every test except those in test_filter
   TestRunResult runGTests(const std::string& repo_path,
     const std::string& test_binary,
     const std::vector<std::string>& test_filter,
     const std::chrono::high_resolution_clock::time_point& validation_start_time,
     const std::string& phase_name,
-    const std::string& patch_id);
+    const std::string& patch_id,
+    bool exclude_filter = false);
 
   // execute shell command
   ExecResult executeCommand(const std::string& command,
@@ -110,9 +135,25 @@ private:
   // flow helpers
   void recordTotalValidationTime(const std::chrono::high_resolution_clock::time_point& start_time);
   ValidationResult validatePatchTwoPhase(const PatchCandidate& patch,
+                                         const std::string& repo_root,
                                          const RepositoryMetadata& repo_metadata,
                                          const std::chrono::high_resolution_clock::time_point& validation_start_time);
 
+  // worker pool flow, see ValidationConfig::num_workers
+  // worker 0 starts out with first_workspace, the clone of first_root. candidates in returned are handed out
+  // before the queue's, the ones a worker could not validate are put back there
+  std::vector<ValidationResult> validatePatchesInWorkspaces(const std::vector<PatchCandidate>& patch_candidates,
+                                                            IValidationQueue& queue,
+                                                            const RepositoryMetadata& repo_metadata,
+                                                            int patches_to_validate,
+                                                            size_t num_workers,
+                                                            const std::string& first_root,
+                                                            std::unique_ptr<Workspace> first_workspace,
+                                                            std::deque<size_t>& returned,
+                                                            const std::chrono::high_resolution_clock::time_point& validation_start_time);
+  // move a workspace's gtest artifacts into the original repository before the workspace goes away
+  void adoptArtifacts(ValidationResult& result, const std::string& repo_root);
+
   template <typename ValidationFunc>
   ValidationResult timedValidation(ValidationFunc&& func, long long& timing_accumulator);
 
@@ -131,6 +172,16 @@ private:
 
   ValidationConfig config_;
   mutable PhaseTiming phase_timing_;
+  std::mutex timing_mutex_;
+
+  // set by the worker that found a plausible patch, running commands of the others are killed
+  std::atomic<bool> cancelled_{false};
+
+  // workspaces whose commands run in their mount namespace, by clone root
+  std::unordered_map<std::string, const Workspace*> mounted_workspaces_;
+  std::mutex mounts_mutex_;
+  // the mounted workspace a working directory lies in, if any
+  const Workspace* mountedWorkspaceFor(const std::string& working_dir);
 
   // repo root resolution
   std::string resolveRepoPathForPatch(const PatchCandidate& patch) const;
@@ -138,6 +189,7 @@ private:
   // snapshot of original file contents before applying a patch
   // key: absolute file path; value: full file content lines
   std::unordered_map<std::string, std::vector<std::string>> original_file_cache_;
+  std::mutex cache_mutex_;
 };
 
 } // namespace apr_system
@@ -0,0 +1,192 @@
+#include "workspace.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/fs.h>
+#endif
+
+namespace apr_system {
+
+namespace {
+
+// Helper, whether a path relative to the repository root lies in git's object store
+bool is_git_object(const std::filesystem::path &relative) {
+    auto it = relative.begin();
+    if (it == relative.end() || *it != ".git") return false;
+    ++it;
+    return it != relative.end() && *it == "objects";
+}
+
+// Helper, share the data blocks of from with the new file to, false if the filesystem cannot
+bool reflink(const std::filesystem::path &from, const std::filesystem::path &to, mode_t mode) {
+#if defined(FICLONE)
+    const int in = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) return false;
+    const int out = ::open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+    const bool ok = ::ioctl(out, FICLONE, in) == 0;
+    ::close(out);
+    ::close(in);
+    if (!ok) ::unlink(to.c_str());
+    return ok;
+#else
+    (void)from;
+    (void)to;
+    (void)mode;
+    return false;
+#endif
+}
+
+// Helper, write a whole /proc file with async-signal-safe calls only
+bool write_proc(const char *path, const std::string &text) {
+    const int fd = ::open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    const bool ok = ::write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size());
+    ::close(fd);
+    return ok;
+}
+
+// Helper, map the current ids onto themselves, so files keep their owners inside the namespace
+std::string id_map(unsigned id) {
+    return std::to_string(id) + " " + std::to_string(id) + " 1\n";
+}
+
+// Helper, private mount namespace with root bind-mounted over target, see enterMountNamespace
+bool enter_namespace(const char *root, const char *target, const std::string &uid_map, const std::string &gid_map) {
+#if defined(__linux__)
+    if (::geteuid() == 0) {
+        if (::unshare(CLONE_NEWNS) != 0) return false;
+    } else {
+        if (::unshare(CLONE_NEWUSER | CLONE_NEWNS) != 0) return false;
+        // an unprivileged gid_map needs setgroups denied first
+        if (!write_proc("/proc/self/setgroups", "deny") || !write_proc("/proc/self/uid_map", uid_map) ||
+            !write_proc("/proc/self/gid_map", gid_map)) {
+            return false;
+        }
+    }
+    // keep the bind mount from propagating back into the parent namespace
+    if (::mount(nullptr, "/", nullptr, MS_REC | MS_PRIVATE, nullptr) != 0) return false;
+    return ::mount(root, target, nullptr, MS_BIND | MS_REC, nullptr) == 0;
+#else
+    (void)root;
+    (void)target;
+    (void)uid_map;
+    (void)gid_map;
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+} // namespace
+
+bool Workspace::mountNamespacesAvailable() {
+    static const bool available = [] {
+        const auto dir = std::filesystem::temp_directory_path();
+        const std::string uid_map = id_map(::geteuid());
+        const std::string gid_map = id_map(::getegid());
+        const pid_t pid = ::fork();
+        if (pid < 0) return false;
+        if (pid == 0) {
+            _exit(enter_namespace(dir.c_str(), dir.c_str(), uid_map, gid_map) ? 0 : 1);
+        }
+        int status = 0;
+        return ::waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }();
+    return available;
+}
+
+bool Workspace::enterMountNamespace() const {
+    return enter_namespace(root_.c_str(), source_.c_str(), uid_map_, gid_map_);
+}
+
+std::unique_ptr<Workspace> Workspace::clone(const std::filesystem::path &source,
+                                            const std::filesystem::path &root) {
+    std::error_code ec;
+    const auto canonical_source = std::filesystem::canonical(source, ec);
+    if (ec) {
+        throw std::runtime_error("failed to resolve repository " + source.string() + ": " + ec.message());
+    }
+    std::filesystem::create_directories(root.parent_path(), ec);
+    if (!std::filesystem::create_directory(root, ec) || ec) {
+        throw std::runtime_error("failed to create workspace " + root.string() +
+                                 (ec ? ": " + ec.message() : ": already exists"));
+    }
+    std::unique_ptr<Workspace> workspace(new Workspace(canonical_source, std::filesystem::absolute(root)));
+    workspace->uid_map_ = id_map(::geteuid());
+    workspace->gid_map_ = id_map(::getegid());
+
+    const auto skip = std::filesystem::weakly_canonical(workspace->root_);
+    auto it = std::filesystem::recursive_directory_iterator(canonical_source, ec);
+    if (ec) {
+        throw std::runtime_error("failed to read repository " + canonical_source.string() + ": " + ec.message());
+    }
+    for (; it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) {
+            throw std::runtime_error("failed to read repository " + canonical_source.string() + ": " + ec.message());
+        }
+        const auto &from = it->path();
+        if (from == skip) {
+            // a workspace placed inside the repository must not clone itself
+            it.disable_recursion_pending();
+            continue;
+        }
+        const auto relative = from.lexically_relative(canonical_source);
+        const auto to = workspace->root_ / relative;
+        const auto status = it->symlink_status();
+        if (std::filesystem::is_symlink(status)) {
+            std::filesystem::copy_symlink(from, to);
+        } else if (std::filesystem::is_directory(status)) {
+            std::filesystem::create_directory(to, from);
+        } else if (std::filesystem::is_regular_file(status)) {
+            workspace->cloneFile(from, to, is_git_object(relative));
+        }
+        // sockets, fifos and devices have no business in a build tree
+    }
+    return workspace;
+}
+
+Workspace::~Workspace() {
+    std::error_code ec;
+    std::filesystem::remove_all(root_, ec);
+}
+
+std::filesystem::path Workspace::relative(const std::filesystem::path &path) const {
+    if (!path.is_absolute()) return path.lexically_normal();
+    return path.lexically_normal().lexically_relative(source_);
+}
+
+void Workspace::cloneFile(const std::filesystem::path &from, const std::filesystem::path &to, bool immutable) {
+    struct stat st{};
+    if (::stat(from.c_str(), &st) != 0) {
+        throw std::runtime_error("failed to stat " + from.string() + ": " + std::strerror(errno));
+    }
+    if (immutable && ::link(from.c_str(), to.c_str()) == 0) {
+        ++hardlinked_;
+        return;
+    }
+    if (reflink(from, to, st.st_mode & 07777)) {
+        ++reflinked_;
+    } else {
+        std::filesystem::copy_file(from, to, std::filesystem::copy_options::overwrite_existing);
+        ++copied_;
+    }
+    // make and ninja compare timestamps, fresh ones would rebuild or skip the wrong targets
+    const struct timespec times[2] = {st.st_atim, st.st_mtim};
+    ::utimensat(AT_FDCWD, to.c_str(), times, 0);
+}
+
+} // namespace apr_system
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+namespace apr_system {
+
+/**
+ * @brief private copy of a repository, build directory included, that one
+ * validation worker can patch, build and test without touching the others
+ *
+ * files are cloned with FICLONE reflinks where the filesystem supports it
+ * (btrfs, xfs), which shares the data blocks copy-on-write, and copied
+ * otherwise. git objects never change once written and are hardlinked.
+ * everything else is not, since compilers and linkers rewrite their outputs
+ * in place and would write through a hardlink into the original. timestamps
+ * are kept so the clone's build tree stays up to date.
+ *
+ * a copied build tree still holds absolute paths into the original
+ * (CMakeCache.txt, generated makefiles). commands that enter the
+ * workspace's mount namespace see the clone at the original path instead,
+ * so its build tree is reused as is and builds stay incremental.
+ *
+ * the directory is removed when the workspace is destroyed.
+ */
+class Workspace {
+public:
+  /**
+   * @brief clone a repository
+   * @param source repository root
+   * @param root directory to create the clone in, must not exist yet
+   * @throws std::runtime_error if the clone cannot be created
+   */
+  static std::unique_ptr<Workspace> clone(const std::filesystem::path &source,
+                                          const std::filesystem::path &root);
+
+  /**
+   * @brief whether enterMountNamespace() works here: root, or unprivileged
+   * user namespaces, plus bind mounts. probed once in a child process
+   */
+  static bool mountNamespacesAvailable();
+
+  /**
+   * @brief make the clone appear at the source path, for the calling
+   * process and everything it starts
+   *
+   * unshares a private mount namespace, inside a new user namespace unless
+   * running as root, and bind-mounts the clone over the source. meant for
+   * a freshly forked child before exec: it makes only async-signal-safe
+   * calls, and a multithreaded process cannot enter a user namespace.
+   *
+   * @return false if a step failed, errno tells why
+   */
+  bool enterMountNamespace() const;
+
+  ~Workspace();
+  Workspace(const Workspace &) = delete;
+  Workspace &operator=(const Workspace &) = delete;
+
+  /**
+   * @brief a path of the source repository relative to the clone's root,
+   * relative paths are taken as relative to the source root already
+   */
+  std::filesystem::path relative(const std::filesystem::path &path) const;
+
+  const std::filesystem::path &source() const { return source_; }
+  const std::filesystem::path &root() const { return root_; }
+
+  // files cloned per method, for the log
+  size_t reflinked() const { return reflinked_; }
+  size_t hardlinked() const { return hardlinked_; }
+  size_t copied() const { return copied_; }
+
+private:
+  Workspace(std::filesystem::path source, std::filesystem::path root)
+      : source_(std::move(source)), root_(std::move(root)) {}
+  void cloneFile(const std::filesystem::path &from, const std::filesystem::path &to, bool immutable);
+
+  std::filesystem::path source_;
+  std::filesystem::path root_;
+  // written to /proc/self/{uid,gid}_map, prepared up front since a forked child must not allocate
+  std::string uid_map_;
+  std::string gid_map_;
+  size_t reflinked_ = 0;
+  size_t hardlinked_ = 0;
+  size_t copied_ = 0;
+};
+
+} // namespace apr_system
@@ -1,6 +1,519 @@
 // Placeholder test for Mutator component
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#include "mutator/mutator.h"
+#include "mutator/similarity_kernels.h"
+#include "mutator/ingredient_index.h"
+#include "mutator/operator_mutations.h"
+#include "core/knowledge_base.h"
+#include "core/trace.h"
+
 TEST(Mutator, Placeholder) {
     SUCCEED();
 }
+
+namespace {
+
+apr_system::ASTNode makeNode(const std::string &id, const std::string &type,
+                             const std::string &text, double suspiciousness) {
+    apr_system::ASTNode node{};
+    node.node_id = id;
+    node.node_type = type;
+    node.start_line = node.end_line = 1;
+    node.start_byte = 0;
+    node.end_byte = static_cast<int>(text.size());
+    node.file_path = "a.cpp";
+    node.source_text = text;
+    node.suspiciousness_score = suspiciousness;
+    return node;
+}
+
+std::string writeFreqJson(const std::string &content) {
+    auto path = std::filesystem::temp_directory_path() / "apr_mutator_freq.json";
+    std::ofstream(path) << content;
+    return path.string();
+}
+
+} // namespace
+
+TEST(Mutator, RulesOnlyPairTargetsWithMatchingIngredientTypes) {
+    // the duplicated replacement rule must not duplicate candidates
+    auto freq = writeFreqJson(R"({
+        "Replacement": [{"target": "identifier", "freq": 0.1}, {"target": "identifier", "freq": 0.2}],
+        "Insertion": [{"target": "identifier", "source": "call_expression", "freq": 0.15}],
+        "Deletion": []
+    })");
+    apr_system::Mutator mutator(freq);
+
+    std::vector<apr_system::ASTNode> nodes = {
+        makeNode("n0", "identifier", "a", 0.9),
+        makeNode("n1", "identifier", "b", 0.0),
+        makeNode("n2", "call_expression", "f()", 0.0),
+        makeNode("n3", "number_literal", "1", 0.0),
+        makeNode("n4", "identifier", "b", 0.0),  // same class as n1
+    };
+    auto patches = mutator.generatePatches(nodes, {});
+
+    ASSERT_EQ(patches.size(), 2u);
+    EXPECT_EQ(patches[0].mutation_type.mutation_category, "Replacement");
+    EXPECT_EQ(patches[0].modified_code, "b");
+    EXPECT_EQ(patches[1].mutation_type.mutation_category, "Insertion");
+    EXPECT_EQ(patches[1].modified_code, "f()");
+    std::filesystem::remove(freq);
+}
+
+TEST(Mutator, NormalizeTextCollapsesWhitespace) {
+    EXPECT_EQ(apr_system::Mutator::normalizeText("  a  +\n\tb "), "a + b");
+    EXPECT_EQ(apr_system::Mutator::normalizeText(""), "");
+}
+
+TEST(Mutator, NormalizeTextKeepsLiteralsVerbatim) {
+    EXPECT_EQ(apr_system::Mutator::normalizeText("f( \"a  b\" ,  ' ' )"), "f( \"a  b\" , ' ' )");
+    EXPECT_EQ(apr_system::Mutator::normalizeText("s ==  \"x\\\"  y\""), "s == \"x\\\"  y\"");
+    EXPECT_EQ(apr_system::Mutator::normalizeText("R\"(a  \")  b)\"  +  1'000  +  1"), "R\"(a  \")  b)\" + 1'000 + 1");
+    EXPECT_NE(apr_system::Mutator::fingerprint("a.cpp", 0, 5, "\"a  b\""),
+              apr_system::Mutator::fingerprint("a.cpp", 0, 5, "\"a b\""));
+    EXPECT_EQ(apr_system::Mutator::fingerprint("a.cpp", 0, 5, "f( \"a  b\")"),
+              apr_system::Mutator::fingerprint("a.cpp", 0, 5, "f(\n\t\"a  b\")"));
+}
+
+TEST(Mutator, IdenticalDeletionsCollapseIntoOneCandidate) {
+    auto freq = writeFreqJson(R"({
+        "Replacement": [],
+        "Insertion": [],
+        "Deletion": [{"target": "expression_statement", "source": "call_expression", "freq": 0.1},
+                     {"target": "expression_statement", "source": "if_statement", "freq": 0.1}]
+    })");
+    apr_system::Mutator mutator(freq);
+
+    std::vector<apr_system::ASTNode> nodes = {
+        makeNode("n0", "expression_statement", "x++;", 0.5),
+        makeNode("n1", "call_expression", "f()", 0.0),
+        makeNode("n2", "call_expression", "g()", 0.0),
+        makeNode("n3", "if_statement", "if (x) y();", 0.0),
+    };
+    auto patches = mutator.generatePatches(nodes, {});
+
+    ASSERT_EQ(patches.size(), 1u);
+    EXPECT_EQ(patches[0].mutation_type.mutation_category, "Deletion");
+    EXPECT_EQ(patches[0].fingerprint, apr_system::Mutator::fingerprint("a.cpp", 0, 4, ""));
+    std::filesystem::remove(freq);
+}
+
+TEST(Mutator, IngredientsNeedingInvisibleLocalsAreRejected) {
+    auto freq = writeFreqJson(R"({
+        "Replacement": [{"target": "identifier", "freq": 0.1}],
+        "Insertion": [],
+        "Deletion": []
+    })");
+    apr_system::Mutator mutator(freq);
+
+    auto target = makeNode("n0", "identifier", "a", 0.9);
+    target.scope_context.visible_names = {"a", "x"};
+    auto visible = makeNode("n1", "identifier", "x", 0.0);
+    visible.scope_context.required_locals = {"x"};
+    auto hidden = makeNode("n2", "identifier", "y", 0.0);
+    hidden.scope_context.required_locals = {"y"};
+    auto member = makeNode("n3", "identifier", "m", 0.0);
+    member.scope_context.required_members = {"m"};
+    std::vector<apr_system::ASTNode> nodes = {target, visible, hidden, member};
+
+    auto patches = mutator.generatePatches(nodes, {});
+    ASSERT_EQ(patches.size(), 1u);
+    EXPECT_EQ(patches[0].modified_code, "x");
+
+    // an out-of-line member function may see any member
+    nodes[0].scope_context.open_members = true;
+    patches = mutator.generatePatches(nodes, {});
+    ASSERT_EQ(patches.size(), 2u);
+    std::filesystem::remove(freq);
+}
+
+TEST(Mutator, TypeFamilies) {
+    using apr_system::Mutator;
+    EXPECT_EQ(Mutator::typeFamily("unsigned long"), "numeric");
+    EXPECT_EQ(Mutator::typeFamily("const uint32_t &"), "numeric");
+    EXPECT_EQ(Mutator::typeFamily("const std::string &"), "string");
+    EXPECT_EQ(Mutator::typeFamily("const char*"), "string");
+    EXPECT_EQ(Mutator::typeFamily("int**"), "pointer");
+    EXPECT_EQ(Mutator::typeFamily("std::vector<int>"), "std::vector");
+    EXPECT_EQ(Mutator::typeFamily("Widget"), "");
+    EXPECT_EQ(Mutator::typeFamily(""), "");
+}
+
+TEST(Mutator, ReplacementsOfAnotherTypeFamilyAreRejected) {
+    auto freq = writeFreqJson(R"({
+        "Replacement": [{"target": "identifier", "freq": 0.1}],
+        "Insertion": [],
+        "Deletion": []
+    })");
+    apr_system::Mutator mutator(freq);
+
+    auto target = makeNode("n0", "identifier", "count", 0.9);
+    target.inferred_type = "int";
+    auto number = makeNode("n1", "identifier", "total", 0.0);
+    number.inferred_type = "long";
+    auto text = makeNode("n2", "identifier", "name", 0.0);
+    text.inferred_type = "std::string";
+    auto unknown = makeNode("n3", "identifier", "w", 0.0);
+    unknown.inferred_type = "Widget";
+    std::vector<apr_system::ASTNode> nodes = {target, number, text, unknown};
+
+    auto patches = mutator.generatePatches(nodes, {});
+    ASSERT_EQ(patches.size(), 2u);
+    for (const auto &patch : patches){
+        EXPECT_NE(patch.modified_code, "name");
+    }
+    std::filesystem::remove(freq);
+}
+
+TEST(Mutator, DenseKernelsMatchMapBasedSimilarity) {
+    using namespace apr_system;
+    // more than 8 node types so the vector path and the tail are both exercised
+    GenealogyContext g_src, g_tgt;
+    DependencyContext d_src, d_tgt;
+    VariableContext v_src, v_tgt;
+    for (int i = 0; i < 13; ++i) {
+        g_src.type_counts["t" + std::to_string(i)] = i % 4;
+        g_tgt.type_counts["t" + std::to_string(i * 2)] = 1 + i % 3;
+        d_src.slice_counts["t" + std::to_string(i)] = 2;
+    }
+    v_src.var_counts = {{"identifier#a", 1}, {"identifier#b", 1}};
+    v_tgt.var_counts = {{"identifier#b", 1}, {"identifier#c", 1}};
+
+    ContextVocabulary vocabulary;
+    vocabulary.add(g_src, d_src, v_src);
+    vocabulary.add(g_tgt, d_tgt, v_tgt);
+    DenseContexts dense(vocabulary);
+    size_t src = dense.add(g_src, d_src, v_src);
+    size_t tgt = dense.add(g_tgt, d_tgt, v_tgt);
+
+    EXPECT_DOUBLE_EQ(dense.genealogySimilarity(src, tgt), computeGenealogySimilarity(g_src, g_tgt));
+    EXPECT_DOUBLE_EQ(dense.dependencySimilarity(src, tgt), computeDependencySimilarity(d_src, d_tgt));
+    EXPECT_DOUBLE_EQ(dense.dependencySimilarity(tgt, src), computeDependencySimilarity(d_tgt, d_src));
+    EXPECT_DOUBLE_EQ(dense.variableSimilarity(src, tgt), computeVariableSimilarity(v_src, v_tgt));
+}
+
+TEST(Mutator, IngredientLocalityDescribesTheNearestClassMember) {
+    auto freq = writeFreqJson(R"({
+        "Replacement": [],
+        "Insertion": [{"target": "identifier", "source": "call_expression", "freq": 0.5}],
+        "Deletion": []
+    })");
+    apr_system::Mutator mutator(freq);
+
+    // the first copy of f() seen is in another file, the class must still point at the nearby one
+    std::vector<apr_system::ASTNode> nodes = {
+        makeNode("far", "call_expression", "f()", 0.0),
+        makeNode("near", "call_expression", "f()", 0.0),
+        makeNode("closer", "call_expression", "f()", 0.0),
+        makeNode("target", "identifier", "x", 0.9),
+    };
+    nodes[0].file_path = "b.cpp";
+    nodes[1].start_line = nodes[1].end_line = 30;
+    nodes[2].start_line = nodes[2].end_line = 10;
+    nodes[3].start_line = nodes[3].end_line = 12;
+    for (auto &node : nodes) node.genealogy_context.type_counts["block"] = 1;
+    auto patches = mutator.generatePatches(nodes, {});
+
+    ASSERT_EQ(patches.size(), 1u);
+    EXPECT_EQ(patches[0].ingredient_file, "a.cpp");
+    EXPECT_EQ(patches[0].ingredient_line, 10);
+    std::filesystem::remove(freq);
+}
+
+TEST(Mutator, OutputDoesNotDependOnThreadCount) {
+    auto freq = writeFreqJson(R"({
+        "Replacement": [{"target": "identifier", "freq": 0.1}],
+        "Insertion": [{"target": "identifier", "source": "call_expression", "freq": 0.15}],
+        "Deletion": [{"target": "identifier", "source": "identifier", "freq": 0.1}]
+    })");
+    std::vector<apr_system::ASTNode> nodes;
+    for (int i = 0; i < 40; ++i) {
+        auto node = makeNode("n" + std::to_string(i), i % 3 ? "identifier" : "call_expression",
+                             "v" + std::to_string(i % 7), i % 2 ? 0.5 : 0.0);
+        node.start_byte = i * 10;
+        node.end_byte = i * 10 + 2;
+        node.genealogy_context.type_counts["block"] = i % 4;
+        nodes.push_back(node);
+    }
+
+    apr_system::Mutator serial(freq), parallel(freq);
+    serial.setThreadCount(1);
+    parallel.setThreadCount(8);
+    auto a = serial.generatePatches(nodes, {});
+    auto b = parallel.generatePatches(nodes, {});
+
+    ASSERT_EQ(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        EXPECT_EQ(nlohmann::json(a[i]).dump(), nlohmann::json(b[i]).dump());
+    }
+    std::filesystem::remove(freq);
+}
+
+TEST(Mutator, GeneratorYieldsBestFirstWithoutExpandingWeakGroups) {
+    auto freq = writeFreqJson(R"({
+        "Replacement": [],
+        "Insertion": [{"target": "identifier", "source": "call_expression", "freq": 0.5}],
+        "Deletion": []
+    })");
+    apr_system::Mutator mutator(freq);
+    mutator.setThreadCount(1);
+
+    std::vector<apr_system::ASTNode> nodes = {
+        makeNode("weak", "identifier", "a", 0.1),
+        makeNode("strong", "identifier", "b", 0.9),
+        makeNode("call", "call_expression", "f()", 0.0),
+    };
+    nodes[1].start_byte = 10;
+    for (auto &node : nodes) node.genealogy_context.type_counts["block"] = 1;
+
+    auto generator = mutator.candidates(nodes);
+    auto first = generator.next();
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(first->target_node_id, "strong");
+    EXPECT_DOUBLE_EQ(first->priority_score, 0.45);
+    EXPECT_EQ(generator.expandedGroups(), 1u);
+    EXPECT_EQ(generator.totalGroups(), 2u);
+
+    auto second = generator.next();
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(second->target_node_id, "weak");
+    EXPECT_FALSE(generator.next().has_value());
+
+    // below the threshold nothing is constructed
+    mutator.setConfidenceThreshold(0.1);
+    EXPECT_EQ(mutator.generatePatches(nodes, {}).size(), 1u);
+    std::filesystem::remove(freq);
+}
+
+TEST(Mutator, MakeDiffPrefixesEveryLine) {
+    EXPECT_EQ(apr_system::Mutator::makeDiff(3, "a\nb", "c"), "@@ -3,2 +3,1 @@\n-a\n-b\n+c\n");
+    EXPECT_EQ(apr_system::Mutator::makeDiff(1, "", "x;\n"), "@@ -1,1 +1,2 @@\n+x;\n");
+}
+
+TEST(Mutator, IngredientIndexRetrievesSimilarContexts) {
+    using namespace apr_system;
+    IngredientIndex index;
+    GenealogyContext target;
+    target.type_counts = {{"if_statement", 2}, {"call_expression", 3}};
+    DependencyContext dependency;
+    VariableContext variables;
+    variables.var_counts = {{"identifier#x", 1}};
+
+    // ingredient 7 shares the target's context, the others only its if statements, 30.. nothing
+    for (size_t id = 0; id < 40; ++id) {
+        GenealogyContext g;
+        if (id == 7) g = target;
+        else if (id < 30) g.type_counts = {{"if_statement", 2}, {"for_statement", static_cast<int>(id + 1)}};
+        else g.type_counts = {{"while_statement", static_cast<int>(id)}};
+        index.add(id, IngredientIndex::signature(IngredientIndex::tokens(g, dependency, id == 7 ? variables : VariableContext{})));
+    }
+
+    auto sig = IngredientIndex::signature(IngredientIndex::tokens(target, dependency, variables));
+    auto top = index.query(sig, 3);
+    ASSERT_EQ(top.size(), 3u);
+    EXPECT_NE(std::find(top.begin(), top.end(), 7u), top.end());
+    EXPECT_TRUE(std::is_sorted(top.begin(), top.end()));
+    // too few collisions widen the bands, they never fall back to a scan of unrelated contexts
+    for (size_t id : index.query(sig, 35)) EXPECT_LT(id, 30u);
+
+    EXPECT_EQ(index.spread(4), (std::vector<size_t>{0, 10, 20, 30}));
+}
+
+TEST(Mutator, RetrievalBoundsTheIngredientsEveryTargetLooksAt) {
+    auto freq = writeFreqJson(R"({
+        "Replacement": [{"target": "identifier", "freq": 0.1}],
+        "Insertion": [{"target": "identifier", "source": "identifier", "freq": 0.1}],
+        "Deletion": [{"target": "identifier", "source": "identifier", "freq": 0.1}]
+    })");
+    std::vector<apr_system::ASTNode> nodes;
+    for (int i = 0; i < 500; ++i) {
+        auto node = makeNode("n" + std::to_string(i), "identifier", "v" + std::to_string(i), i < 3 ? 0.5 : 0.0);
+        node.start_byte = i * 10;
+        node.end_byte = i * 10 + 2;
+        node.genealogy_context.type_counts = {{"block", 1 + i % 5}, {"call_expression", i % 3}};
+        nodes.push_back(node);
+    }
+
+    constexpr size_t kTopM = 8;
+    apr_system::Mutator mutator(freq);
+    mutator.setThreadCount(1);
+    mutator.setRetrievalTopM(kTopM);
+    auto generator = mutator.candidates(nodes);
+    size_t yielded = 0;
+    while (generator.next()) ++yielded;
+
+    EXPECT_GT(yielded, 0u);
+    EXPECT_EQ(generator.expandedGroups(), 9u);
+    EXPECT_LE(generator.consideredIngredients(), generator.expandedGroups() * kTopM);
+    std::filesystem::remove(freq);
+}
+
+TEST(Mutator, OperatorMutationsRewriteTheTopLevelOperator) {
+    using apr_system::operatorMutations;
+    auto texts = [](const std::vector<apr_system::OperatorMutation> &mutations, const std::string &cls) {
+        std::vector<std::string> out;
+        for (const auto &m : mutations) {
+            if (m.operator_class == cls) out.push_back(m.text);
+        }
+        return out;
+    };
+
+    auto loop = operatorMutations("binary_expression", "i < n - 1");
+    EXPECT_EQ(texts(loop, "boundary"), std::vector<std::string>{"i <= n - 1"});
+    EXPECT_EQ(texts(loop, "relational"), std::vector<std::string>{"i > n - 1"});
+    EXPECT_EQ(texts(loop, "bound"), (std::vector<std::string>{"i < n - 1 + 1", "i < n - 1 - 1"}));
+    EXPECT_TRUE(texts(loop, "arithmetic").empty());
+
+    // the root of a + b * (c - d) is the +, casts and unary minus are not split
+    auto sum = operatorMutations("binary_expression", "a + b * (c - d)");
+    EXPECT_EQ(texts(sum, "arithmetic"), std::vector<std::string>{"a - b * (c - d)"});
+    auto cast = operatorMutations("binary_expression", "static_cast<int>(x) * -y");
+    EXPECT_EQ(texts(cast, "arithmetic"), std::vector<std::string>{"static_cast<int>(x) / -y"});
+    EXPECT_TRUE(operatorMutations("binary_expression", "x = y + 1").empty());
+
+    EXPECT_EQ(texts(operatorMutations("number_literal", "10u"), "literal"),
+              (std::vector<std::string>{"11u", "9u"}));
+    EXPECT_EQ(texts(operatorMutations("number_literal", "0"), "literal"), std::vector<std::string>{"1"});
+    EXPECT_TRUE(operatorMutations("number_literal", "1.5").empty());
+
+    EXPECT_EQ(texts(operatorMutations("condition_clause", "(a && b)"), "negation"),
+              std::vector<std::string>{"(!(a && b))"});
+    EXPECT_EQ(texts(operatorMutations("condition_clause", "(!(done))"), "negation"),
+              std::vector<std::string>{"(done)"});
+    EXPECT_TRUE(operatorMutations("condition_clause", "(int n = f())").empty());
+}
+
+TEST(Mutator, OperatorRulesNeedNoIngredients) {
+    auto freq = writeFreqJson(R"({
+        "Replacement": [],
+        "Insertion": [],
+        "Deletion": [],
+        "Operator": [{"target": "binary_expression", "source": "boundary", "freq": 0.5}]
+    })");
+    apr_system::Mutator mutator(freq);
+
+    std::vector<apr_system::ASTNode> nodes = {makeNode("n0", "binary_expression", "i < n", 0.8)};
+    auto patches = mutator.generatePatches(nodes, {});
+
+    ASSERT_EQ(patches.size(), 1u);
+    EXPECT_EQ(patches[0].mutation_type.mutation_category, "Operator");
+    EXPECT_EQ(patches[0].mutation_type.source_node, "boundary");
+    EXPECT_EQ(patches[0].modified_code, "i <= n");
+    EXPECT_DOUBLE_EQ(patches[0].priority_score, 0.4);
+    std::filesystem::remove(freq);
+}
+
+TEST(Mutator, TraceIsOptInAndWritesNdjson) {
+    auto freq = writeFreqJson(R"({
+        "Replacement": [{"target": "identifier", "freq": 0.1}],
+        "Insertion": [],
+        "Deletion": []
+    })");
+    apr_system::Mutator mutator(freq);
+    std::vector<apr_system::ASTNode> nodes = {
+        makeNode("n0", "identifier", "a", 0.9),
+        makeNode("n1", "identifier", "b", 0.0),
+    };
+
+    using apr_system::Trace;
+    EXPECT_FALSE(Trace::enabled(Trace::Stage::Mutator));
+    EXPECT_EQ(Trace::parseStages("mutator,validator"),
+              static_cast<unsigned>(Trace::Stage::Mutator) | static_cast<unsigned>(Trace::Stage::Validator));
+    EXPECT_FALSE(Trace::parseStages("mutator,bogus").has_value());
+
+    auto path = std::filesystem::temp_directory_path() / "apr_trace.ndjson";
+    Trace::open(path.string(), *Trace::parseStages("mutator"));
+    EXPECT_FALSE(Trace::enabled(Trace::Stage::Prioritizer));
+    mutator.generatePatches(nodes, {});
+    Trace::close();
+
+    std::ifstream in(path);
+    std::vector<std::string> events;
+    for (std::string line; std::getline(in, line);) {
+        auto record = nlohmann::json::parse(line);
+        EXPECT_EQ(record["stage"], "mutator");
+        events.push_back(record["event"]);
+    }
+    EXPECT_EQ(events, (std::vector<std::string>{"target", "ingredient", "candidate"}));
+    std::filesystem::remove(path);
+    std::filesystem::remove(freq);
+}
+
+TEST(Mutator, KnowledgeBasePersistsAndPutsKnownFixesFirst) {
+    using apr_system::KnowledgeBase;
+    auto path = std::filesystem::temp_directory_path() / "apr_knowledge.kb";
+    std::filesystem::remove(path);
+
+    // the insertion is historically rarer, but it fixed a bug here before
+    auto freq = writeFreqJson(R"({
+        "Replacement": [{"target": "identifier", "freq": 0.2}],
+        "Insertion": [{"target": "identifier", "source": "call_expression", "freq": 0.15}],
+        "Deletion": []
+    })");
+    std::vector<apr_system::ASTNode> nodes = {
+        makeNode("n0", "identifier", "a", 0.9),
+        makeNode("n1", "identifier", "b", 0.0),
+        makeNode("n2", "call_expression", "f()", 0.0),
+    };
+    const uint64_t shape = KnowledgeBase::key("identifier", KnowledgeBase::genealogyHash(nodes[0].genealogy_context),
+                                              "Insertion", "call_expression");
+    {
+        auto kb = KnowledgeBase::open(path.string());
+        EXPECT_EQ(kb->successes(shape), 0u);
+        kb->recordSuccess(shape);
+        // enough shapes to grow the file past its initial capacity
+        for (uint64_t k = 1; k <= 1000; ++k) kb->recordSuccess(k * 0x9e3779b97f4a7c15ull);
+    }
+    std::shared_ptr<KnowledgeBase> kb = KnowledgeBase::open(path.string());
+    EXPECT_EQ(kb->size(), 1001u);
+    EXPECT_EQ(kb->successes(shape), 1u);
+    EXPECT_EQ(kb->successes(0x9e3779b97f4a7c15ull * 7), 1u);
+    EXPECT_DOUBLE_EQ(kb->boost(shape), 2.0);
+
+    apr_system::Mutator mutator(freq);
+    mutator.setKnowledgeBase(kb);
+    auto patches = mutator.generatePatches(nodes, {});
+    ASSERT_EQ(patches.size(), 2u);
+    EXPECT_EQ(patches[0].mutation_type.mutation_category, "Insertion");
+    EXPECT_EQ(KnowledgeBase::key(patches[0]), shape);
+
+    kb.reset();
+    std::filesystem::remove(path);
+    std::filesystem::remove(freq);
+
+    // anything else is refused
+    std::ofstream(path) << "not a knowledge base";
+    EXPECT_THROW(KnowledgeBase::open(path.string()), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST(Mutator, KnowledgeBaseHandlesSharingAFileKeepEveryRecord) {
+    using apr_system::KnowledgeBase;
+    auto path = std::filesystem::temp_directory_path() / "apr_knowledge_shared.kb";
+    std::filesystem::remove(path);
+
+    // two runs open the same file, the second one grows it before the first records
+    auto first = KnowledgeBase::open(path.string());
+    auto second = KnowledgeBase::open(path.string());
+    for (uint64_t k = 1; k <= 1000; ++k) second->recordSuccess(k * 0x9e3779b97f4a7c15ull);
+    first->recordSuccess(42);
+    first->recordSuccess(0x9e3779b97f4a7c15ull);
+    EXPECT_EQ(first->size(), 1001u);
+    first.reset();
+    second.reset();
+
+    auto kb = KnowledgeBase::open(path.string());
+    EXPECT_EQ(kb->size(), 1001u);
+    EXPECT_EQ(kb->successes(42), 1u);
+    EXPECT_EQ(kb->successes(0x9e3779b97f4a7c15ull), 2u);
+    EXPECT_EQ(kb->successes(0x9e3779b97f4a7c15ull * 1000), 1u);
+    EXPECT_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+    kb.reset();
+    std::filesystem::remove(path);
+}
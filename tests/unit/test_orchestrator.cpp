@@ -1,6 +1,105 @@
 // Placeholder test for Orchestrator component
 #include <gtest/gtest.h>
 
+#include "core/frequency_model.h"
+#include "orchestrator/orchestrator.h"
+#include "prioritizer/prioritizer.h"
+
+#include <algorithm>
+
 TEST(Orchestrator, Placeholder) {
     SUCCEED();
 }
+
+namespace {
+
+struct FakeSBFL : apr_system::ISBFL {
+    std::vector<apr_system::SuspiciousLocation> localizeFaults(const std::string &) override {
+        return std::vector<apr_system::SuspiciousLocation>(1);
+    }
+    void runSBFLAnalysis(const std::string &, std::string &) override {}
+};
+
+struct FakeParser : apr_system::IParser {
+    std::vector<apr_system::ASTNode> parseAST(const std::vector<apr_system::SuspiciousLocation> &,
+                                              const std::vector<std::string> &) override {
+        return std::vector<apr_system::ASTNode>(1);
+    }
+};
+
+struct FakeMutator : apr_system::IMutator {
+    std::vector<apr_system::PatchCandidate> candidates;
+    std::vector<apr_system::PatchCandidate> generatePatches(const std::vector<apr_system::ASTNode> &,
+                                                            const std::vector<std::string> &) override {
+        return candidates;
+    }
+};
+
+// pulls candidates like the validator, every one fails to build
+struct FakeValidator : apr_system::IValidator {
+    std::vector<size_t> *order;
+    explicit FakeValidator(std::vector<size_t> *order) : order(order) {}
+    std::vector<apr_system::ValidationResult> validatePatches(const std::vector<apr_system::PatchCandidate> &,
+                                                              apr_system::IValidationQueue &queue,
+                                                              const apr_system::RepositoryMetadata &,
+                                                              int top_k) override {
+        std::vector<apr_system::ValidationResult> results;
+        while (static_cast<int>(results.size()) < top_k) {
+            const auto next = queue.next();
+            if (!next) break;
+            order->push_back(*next);
+            results.emplace_back();
+            queue.record(*next, results.back());
+        }
+        return results;
+    }
+};
+
+} // namespace
+
+TEST(Orchestrator, DiversityReachesLocationsBelowTheRankedTop) {
+    using apr_system::Orchestrator;
+    // more candidates at line 10 than the default ranking holds, all scoring above the ones at line 20
+    auto mutator = std::make_unique<FakeMutator>();
+    const size_t crowded = Orchestrator::kRankedCandidates + 50;
+    for (size_t i = 0; i < crowded + 10; ++i) {
+        apr_system::PatchCandidate patch;
+        patch.patch_id = "patch_" + std::to_string(i);
+        patch.file_path = "calc.cpp";
+        patch.start_line = i < crowded ? 10 : 20;
+        patch.mutation_type = {"Replacement", "identifier", "identifier"};
+        patch.similarity_score = 1.0 - 0.001 * static_cast<double>(i);
+        patch.suspiciousness_score = 1.0;
+        mutator->candidates.push_back(std::move(patch));
+    }
+    const auto candidates = mutator->candidates;
+
+    const auto run = [&](size_t ranked) {
+        auto prioritizer = std::make_unique<apr_system::Prioritizer>();
+        prioritizer->setFrequencyModel(apr_system::FrequencyModel::fromEntries({{{{"", "identifier", 0.5}}, {}, {}, {}}}));
+        prioritizer->setDiversity(1.0);
+        std::vector<size_t> order;
+        Orchestrator orchestrator;
+        orchestrator.setRankedCandidates(ranked);
+        orchestrator.setComponents(std::make_unique<FakeSBFL>(), std::make_unique<FakeParser>(),
+                                   std::make_unique<FakeMutator>(*mutator), std::move(prioritizer),
+                                   std::make_unique<FakeValidator>(&order));
+        orchestrator.runPipeline({}, "", "");
+        return order;
+    };
+    const auto atLine20 = [&](const std::vector<size_t> &order) {
+        return std::count_if(order.begin(), order.end(),
+                             [&](size_t i) { return candidates[i].start_line == 20; });
+    };
+
+    // the score-sorted top only holds line 10, interleaving inside it cannot leave that line
+    const auto top = run(Orchestrator::kRankedCandidates);
+    ASSERT_EQ(top.size(), Orchestrator::kValidationTopK);
+    EXPECT_EQ(atLine20(top), 0);
+
+    // drawing from every candidate, the queue gets to line 20 early
+    const auto all = run(0);
+    ASSERT_EQ(all.size(), Orchestrator::kValidationTopK);
+    EXPECT_EQ(atLine20(all), 10);
+    EXPECT_EQ(candidates[all[1]].start_line, 20);
+}
@@ -1,6 +1,128 @@
 // Placeholder test for Parser component
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+#include "parser/include_graph.h"
+#include "parser/parser.h"
+
 TEST(Parser, Placeholder) {
     SUCCEED();
 }
+
+TEST(Parser, IncludeGraphListsSharedHeaderOnce) {
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / "apr_include_graph_test";
+    fs::remove_all(root);
+    fs::create_directories(root / "src" / "nested");
+    fs::create_directories(root / "include");
+    std::ofstream(root / "include" / "shared.h") << "#pragma once\nint shared();\n";
+    std::ofstream(root / "src" / "a.cpp") << "#include \"shared.h\"\nint a() { return shared(); }\n";
+    std::ofstream(root / "src" / "nested" / "b.cpp") << "#include <shared.h>\nint b() { return shared(); }\n";
+
+    auto graph = apr_system::IncludeGraph::discover(root.string());
+    auto files = graph.sourceFiles();
+    EXPECT_EQ(files.size(), 3u);
+    EXPECT_EQ(std::count_if(files.begin(), files.end(), [](const std::string &f) {
+        return f.ends_with("shared.h");
+    }), 1);
+    EXPECT_EQ(graph.dependentTranslationUnits((root / "include" / "shared.h").string()).size(), 2u);
+
+    fs::remove_all(root);
+}
+
+TEST(Parser, IncludeGraphFollowsTheCompilationDatabase) {
+    namespace fs = std::filesystem;
+    const fs::path root = fs::weakly_canonical(fs::temp_directory_path()) / "apr_compile_commands_test";
+    fs::remove_all(root);
+    for (const char *dir : {"src", "include", "tests", "build"}) fs::create_directories(root / dir);
+    std::ofstream(root / "include" / "shared.h") << "#pragma once\nint shared();\n";
+    std::ofstream(root / "include" / "config.h") << "#pragma once\n";
+    std::ofstream(root / "src" / "app.cpp") << "#include <shared.h>\nint app() { return shared(); }\n";
+    std::ofstream(root / "src" / "util.cpp") << "#include \"shared.h\"\nint util() { return shared(); }\n";
+    // compiled by nobody, a directory scan would pick it up
+    std::ofstream(root / "src" / "unused.cpp") << "int unused() { return 0; }\n";
+    std::ofstream(root / "tests" / "test_app.cpp") << "#include <shared.h>\n";
+    std::ofstream(root / "build" / "generated.cpp") << "#include <config.h>\n";
+
+    // relative files and -I dirs resolve against each entry's directory, a file outside the project is skipped
+    nlohmann::json db = nlohmann::json::array({
+        {{"directory", (root / "build").string()}, {"file", "../src/app.cpp"},
+         {"command", "g++ -I../include -c ../src/app.cpp"}},
+        {{"directory", root.string()}, {"file", "src/util.cpp"},
+         {"arguments", {"g++", "-iquote", "include", "-c", "src/util.cpp"}}},
+        {{"directory", root.string()}, {"file", "tests/test_app.cpp"},
+         {"command", "g++ -Iinclude -c tests/test_app.cpp"}},
+        {{"directory", (root / "build").string()}, {"file", (root / "build" / "generated.cpp").string()},
+         {"command", "g++ -I" + (root / "include").string() + " -c generated.cpp"}},
+        {{"directory", "/"}, {"file", "/usr/src/elsewhere.cpp"}, {"command", "g++ -c /usr/src/elsewhere.cpp"}},
+    });
+    std::ofstream(root / "build" / "compile_commands.json") << db.dump();
+
+    auto graph = apr_system::IncludeGraph::discover(root.string());
+    const auto sorted = [](std::vector<std::string> v) {
+        std::sort(v.begin(), v.end());
+        return v;
+    };
+    const auto at = [&](const char *path) { return (root / path).string(); };
+
+    EXPECT_EQ(sorted(graph.translationUnits()),
+              sorted({at("build/generated.cpp"), at("src/app.cpp"), at("src/util.cpp"), at("tests/test_app.cpp")}));
+    // the build directory and tests are not repair candidates, headers reached from them are
+    EXPECT_EQ(sorted(graph.sourceFiles()),
+              sorted({at("include/config.h"), at("include/shared.h"), at("src/app.cpp"), at("src/util.cpp")}));
+    EXPECT_EQ(sorted(graph.dependentTranslationUnits(at("include/shared.h"))),
+              sorted({at("src/app.cpp"), at("src/util.cpp"), at("tests/test_app.cpp")}));
+    EXPECT_EQ(graph.dependentTranslationUnits(at("include/config.h")),
+              std::vector<std::string>{at("build/generated.cpp")});
+    EXPECT_EQ(graph.dependentTranslationUnits(at("src/util.cpp")), std::vector<std::string>{at("src/util.cpp")});
+    EXPECT_TRUE(graph.dependentTranslationUnits(at("src/unused.cpp")).empty());
+
+    fs::remove_all(root);
+}
+
+TEST(Parser, IncrementalReparseMatchesAFreshParse) {
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / "apr_incremental_parse_test";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    const auto file = (root / "math.cpp").string();
+    std::ofstream(file) <<
+        "int scale(int x) {\n"
+        "    int factor = 2;\n"
+        "    return x * factor;\n"
+        "}\n"
+        "int add(int a, int b) {\n"
+        "    int total = a - b;\n"
+        "    return total;\n"
+        "}\n";
+    const std::vector<apr_system::SuspiciousLocation> locations = {{file, 6, 0.9, "ochiai"}};
+
+    apr_system::Parser parser;
+    ASSERT_FALSE(parser.parseAST(locations, {file}).empty());
+
+    // the patch renames a local and changes the operator, the nodes after it shift
+    std::ofstream(file) <<
+        "int scale(int x) {\n"
+        "    int factor = 2;\n"
+        "    return x * factor;\n"
+        "}\n"
+        "int add(int a, int b) {\n"
+        "    int sum = a + b;\n"
+        "    return sum;\n"
+        "}\n"
+        "int twice(int y) { return add(y, y); }\n";
+    const auto incremental = parser.parseAST(locations, {file});
+    const auto fresh = apr_system::Parser().parseAST(locations, {file});
+
+    ASSERT_EQ(incremental.size(), fresh.size());
+    for (size_t i = 0; i < fresh.size(); ++i) {
+        EXPECT_EQ(nlohmann::json(incremental[i]), nlohmann::json(fresh[i]))
+            << fresh[i].node_type << " at " << fresh[i].start_line << ":" << fresh[i].start_column;
+    }
+
+    fs::remove_all(root);
+}
@@ -1,6 +1,239 @@
 // Placeholder test for Prioritizer component
 #include <gtest/gtest.h>
 
+#include "builtin_frequencies.h"
+#include "core/frequency_model.h"
+#include "prioritizer/prioritizer.h"
+#include "prioritizer/ranking_model.h"
+
+#include <filesystem>
+
 TEST(Prioritizer, Placeholder) {
     SUCCEED();
 }
+
+TEST(Prioritizer, FrequencyModelLookupMatchesLastEntry) {
+    using apr_system::FrequencyModel;
+    using Category = FrequencyModel::Category;
+    auto model = FrequencyModel::fromEntries({{
+        {{"", "identifier", 0.1}, {"", "identifier", 0.3}},
+        {{"call_expression", "expression_statement", 0.2}},
+        {},
+        {{"boundary", "binary_expression", 0.05}},
+    }});
+
+    // replacements ignore the source, the last duplicate wins
+    EXPECT_DOUBLE_EQ(model->lookup({"Replacement", "identifier", "whatever"}), 0.3);
+    EXPECT_DOUBLE_EQ(model->lookup({"Insertion", "expression_statement", "call_expression"}), 0.2);
+    EXPECT_DOUBLE_EQ(model->lookup({"Insertion", "expression_statement", "if_statement"}), 0.0);
+    EXPECT_DOUBLE_EQ(model->lookup({"Deletion", "expression_statement", "call_expression"}), 0.0);
+    EXPECT_DOUBLE_EQ(model->lookup({"Operator", "binary_expression", "boundary"}), 0.05);
+    EXPECT_DOUBLE_EQ(model->lookup({"Unknown", "identifier", ""}), 0.0);
+    EXPECT_DOUBLE_EQ(model->lookup(Category::Insertion, model->symbol("expression_statement"),
+                                   model->symbol("call_expression")), 0.2);
+    EXPECT_EQ(model->symbol("never_seen"), FrequencyModel::kUnknown);
+}
+
+TEST(Prioritizer, BuiltinFrequenciesMatchTheJson) {
+    using apr_system::FrequencyModel;
+    namespace builtin = apr_system::builtin_frequencies;
+    auto compiled = FrequencyModel::builtin();
+    auto parsed = FrequencyModel::load(std::string(PROJECT_SOURCE_DIR) + "/test-data/freq.json");
+    EXPECT_TRUE(compiled->sourcePath().empty());
+    EXPECT_EQ(compiled, FrequencyModel::builtin());
+
+    // the generated tables keep the json loader's symbol order, same entries and lookups
+    for (size_t i = 0; i < builtin::kSymbols.size(); ++i) {
+        EXPECT_EQ(compiled->symbol(builtin::kSymbols[i]), i + 1);
+    }
+    for (const char *name : {"Replacement", "Insertion", "Deletion"}) {
+        const auto category = *FrequencyModel::categoryOf(name);
+        ASSERT_EQ(compiled->entries(category).size(), parsed->entries(category).size());
+        for (const auto &e : parsed->entries(category)) {
+            const apr_system::MutationType type{name, e.target_node, e.source_node};
+            EXPECT_EQ(compiled->symbol(e.target_node), parsed->symbol(e.target_node));
+            EXPECT_EQ(compiled->lookup(type), parsed->lookup(type));
+        }
+    }
+    // the json's operator frequencies are placeholders, only --freq-json loads them
+    EXPECT_TRUE(compiled->entries(FrequencyModel::Category::Operator).empty());
+    EXPECT_FALSE(parsed->entries(FrequencyModel::Category::Operator).empty());
+}
+
+TEST(Prioritizer, ScoresWithTheSharedModel) {
+    auto model = apr_system::FrequencyModel::fromEntries({{{{"", "identifier", 0.5}}, {}, {}, {}}}, "shared.json");
+    apr_system::Prioritizer prioritizer;
+    prioritizer.setFrequencyModel(model);
+
+    apr_system::PatchCandidate low, high, unknown;
+    low.patch_id = "low";
+    low.mutation_type = {"Replacement", "identifier", "identifier"};
+    low.similarity_score = 0.5;
+    low.suspiciousness_score = 0.4;
+    high = low;
+    high.patch_id = "high";
+    high.similarity_score = 1.0;
+    unknown = low;
+    unknown.patch_id = "unknown";
+    unknown.mutation_type.target_node = "call_expression";
+
+    // the path matches the model's, so nothing is read from disk
+    auto ranked = prioritizer.prioritizePatches({low, unknown, high}, "shared.json");
+    ASSERT_EQ(ranked.size(), 2u);
+    EXPECT_EQ(ranked[0].candidate, 2u);
+    EXPECT_DOUBLE_EQ(ranked[0].priority_score, 0.2);
+    EXPECT_EQ(ranked[1].candidate, 0u);
+}
+
+TEST(Prioritizer, RanksOnlyTheTopKAsIndices) {
+    auto model = apr_system::FrequencyModel::fromEntries({{{{"", "identifier", 1.0}}, {}, {}, {}}}, "topk.json");
+    apr_system::Prioritizer prioritizer;
+    prioritizer.setFrequencyModel(model);
+    prioritizer.setThreadCount(4);
+
+    // enough candidates for several scoring chunks, every 7th one has no frequency
+    std::vector<apr_system::PatchCandidate> candidates(5000);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        candidates[i].mutation_type = {"Replacement", i % 7 == 0 ? "call_expression" : "identifier", ""};
+        candidates[i].similarity_score = static_cast<double>(i % 100) / 100.0;
+        candidates[i].suspiciousness_score = 1.0;
+    }
+
+    auto all = prioritizer.prioritizePatches(candidates, "topk.json");
+    auto top = prioritizer.prioritizePatches(candidates, "topk.json", 10);
+    ASSERT_EQ(top.size(), 10u);
+    ASSERT_GT(all.size(), 10u);
+    for (size_t r = 0; r < top.size(); ++r) {
+        // the top-k is the prefix of the full ranking, ties in candidate order
+        EXPECT_EQ(top[r].candidate, all[r].candidate);
+        EXPECT_DOUBLE_EQ(top[r].priority_score, 0.99);
+        if (r > 0) {
+            EXPECT_LT(top[r - 1].candidate, top[r].candidate);
+        }
+    }
+    for (const auto &ranked : all) {
+        EXPECT_GT(ranked.priority_score, 0.0);
+        EXPECT_NE(ranked.candidate % 7, 0u);
+    }
+}
+
+TEST(Prioritizer, ProductModelReproducesTheFixedScore) {
+    using apr_system::FeatureMatrix;
+    auto model = apr_system::FrequencyModel::fromEntries({{{{"", "identifier", 0.25}}, {}, {}, {}}});
+    std::vector<apr_system::PatchCandidate> candidates(3);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        candidates[i].mutation_type = {"Replacement", "identifier", "identifier"};
+        candidates[i].similarity_score = 0.1 * static_cast<double>(i + 1);
+        candidates[i].suspiciousness_score = 0.8;
+    }
+    const auto features = FeatureMatrix::extract(candidates, *model);
+    EXPECT_EQ(features.rows, 3u);
+    EXPECT_EQ(features.columns[FeatureMatrix::Replacement][0], 1.0);
+    EXPECT_EQ(features.columns[FeatureMatrix::SameNodeType][0], 1.0);
+
+    std::vector<double> scores(features.rows);
+    apr_system::RankingModel::product().score(features, scores);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        EXPECT_EQ(scores[i], candidates[i].similarity_score * 0.8 * 0.25);
+    }
+}
+
+TEST(Prioritizer, TrainedRankingModelPrefersPlausibleFeatures) {
+    using apr_system::FeatureMatrix;
+    using apr_system::RankingModel;
+    auto frequencies = apr_system::FrequencyModel::fromEntries({{{{"", "identifier", 0.5}}, {}, {}, {}}});
+
+    // identical scores, but only candidates with an ingredient from the same file passed
+    std::vector<apr_system::PatchCandidate> candidates(200);
+    std::vector<bool> plausible(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        auto &p = candidates[i];
+        p.mutation_type = {"Replacement", "identifier", "identifier"};
+        p.similarity_score = 0.5;
+        p.suspiciousness_score = 0.5;
+        p.file_path = "calc.cpp";
+        p.start_line = 10;
+        p.ingredient_file = i % 2 ? "calc.cpp" : "other.cpp";
+        p.ingredient_line = 12;
+        plausible[i] = i % 2 == 1;
+    }
+    const auto model = RankingModel::train(FeatureMatrix::extract(candidates, *frequencies), plausible);
+    EXPECT_GT(model.weight(FeatureMatrix::IngredientSameFile), 0.0);
+    // constant columns keep the product's weights
+    EXPECT_EQ(model.weight(FeatureMatrix::LogSimilarity), 1.0);
+
+    auto path = std::filesystem::temp_directory_path() / "apr_ranking_model.json";
+    model.save(path.string());
+    const auto loaded = RankingModel::load(path.string());
+    std::filesystem::remove(path);
+    for (size_t f = 0; f < FeatureMatrix::kFeatures; ++f) {
+        EXPECT_DOUBLE_EQ(loaded.weight(f), model.weight(f)) << FeatureMatrix::name(f);
+    }
+
+    apr_system::Prioritizer prioritizer;
+    prioritizer.setFrequencyModel(frequencies);
+    prioritizer.setRankingModel(loaded);
+    auto ranked = prioritizer.prioritizePatches({candidates[0], candidates[1]}, "", 0);
+    ASSERT_EQ(ranked.size(), 2u);
+    EXPECT_EQ(ranked[0].candidate, 1u);
+}
+
+TEST(Prioritizer, ValidationQueueMovesAwayFromFailingLocations) {
+    // four candidates at line 10 ranked above two at line 20
+    std::vector<apr_system::PatchCandidate> candidates(6);
+    std::vector<apr_system::RankedPatch> ranking;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        candidates[i].file_path = "calc.cpp";
+        candidates[i].start_line = i < 4 ? 10 : 20;
+        candidates[i].mutation_type = {"Replacement", "identifier", "identifier"};
+        ranking.push_back({i, 1.0 - 0.01 * static_cast<double>(i)});
+    }
+    apr_system::AdaptiveValidationQueue queue(candidates, ranking, 0.0);
+    EXPECT_EQ(queue.size(), 6u);
+
+    apr_system::ValidationResult failed{};
+    failed.compilation_success = false;
+    apr_system::ValidationResult half{};
+    half.compilation_success = true;
+    half.tests_passed_count = 1;
+    half.tests_total_count = 2;
+
+    // the untouched queue hands out the ranking
+    EXPECT_EQ(queue.next(), 0u);
+    queue.record(0, failed);
+    // one compile failure at line 10 is enough to try line 20 first
+    EXPECT_LT(queue.locationMean(candidates[1]), queue.locationMean(candidates[4]));
+    EXPECT_EQ(queue.next(), 4u);
+    queue.record(4, half);
+    EXPECT_EQ(queue.next(), 5u);
+    queue.record(5, failed);
+    EXPECT_EQ(queue.next(), 1u);
+    EXPECT_EQ(queue.next(), 2u);
+    EXPECT_EQ(queue.next(), 3u);
+    EXPECT_FALSE(queue.next());
+
+    EXPECT_DOUBLE_EQ(apr_system::AdaptiveValidationQueue::reward(half), 0.75);
+}
+
+TEST(Prioritizer, ValidationQueueInterleavesLocations) {
+    // the three best candidates all edit line 10, a slightly worse one line 20
+    std::vector<apr_system::PatchCandidate> candidates(4);
+    std::vector<apr_system::RankedPatch> ranking;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        candidates[i].file_path = "calc.cpp";
+        candidates[i].start_line = i < 3 ? 10 : 20;
+        candidates[i].mutation_type = {"Replacement", "identifier", "identifier"};
+        ranking.push_back({i, 1.0 - 0.1 * static_cast<double>(i)});
+    }
+    candidates[1].mutation_type = {"Operator", "binary_expression", "boundary"};
+
+    std::vector<size_t> order;
+    apr_system::AdaptiveValidationQueue queue(candidates, ranking);
+    while (auto next = queue.next()) order.push_back(*next);
+    // the operator mutation is a new family and keeps its place, the second
+    // line-10 replacement falls behind line 20
+    EXPECT_EQ(order, (std::vector<size_t>{0, 1, 3, 2}));
+
+    EXPECT_EQ(apr_system::AdaptiveValidationQueue::familyKey(candidates[1]), "Operator:boundary");
+    EXPECT_EQ(apr_system::AdaptiveValidationQueue::familyKey(candidates[0]), "Replacement");
+}
@@ -1,6 +1,317 @@
 // placeholder test for validator component
 #include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include "prioritizer/validation_queue.h"
+#include "validator/diagnostics.h"
+#include "validator/validator.h"
+#include "validator/workspace.h"
+#include <sys/wait.h>
+#include <unistd.h>
 
 TEST(Validator, Placeholder) {
     SUCCEED();
 }
+
+namespace {
+
+apr_system::PatchCandidate makePatch(const std::string &id, const std::string &category,
+                                     int line, const std::string &code) {
+    apr_system::PatchCandidate patch;
+    patch.patch_id = id;
+    patch.file_path = "src/math.cpp";
+    patch.start_line = line;
+    patch.end_line = line;
+    patch.modified_code = code;
+    patch.mutation_type.mutation_category = category;
+    return patch;
+}
+
+std::string readFile(const std::filesystem::path &path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// stands in for a gtest binary: passes once math.cpp adds, logs its filter, writes the xml it is asked for
+void writeFakeGTest(const std::filesystem::path &repo) {
+    std::ofstream(repo / "test.sh") <<
+        "for arg in \"$@\"; do\n"
+        "  case \"$arg\" in\n"
+        "    --gtest_output=xml:*) out=\"${arg#--gtest_output=xml:}\" ;;\n"
+        "    --gtest_filter=*) echo \"$arg\" >> filters.log ;;\n"
+        "  esac\n"
+        "done\n"
+        "if grep -q 'a + b' src/math.cpp; then\n"
+        "  echo '<testsuites tests=\"1\" failures=\"0\" errors=\"0\">' > \"$out\"; exit 0\n"
+        "fi\n"
+        "echo '<testsuites tests=\"1\" failures=\"1\" errors=\"0\">' > \"$out\"; exit 1\n";
+}
+
+} // namespace
+
+TEST(Validator, ParsesGccAndClangDiagnostics) {
+    auto diagnostics = apr_system::parseCompilerDiagnostics(
+        "[ 50%] Building CXX object math.cpp.o\n"
+        "/repo/src/math.cpp:12:9: error: \xE2\x80\x98total\xE2\x80\x99 was not declared in this scope\n"
+        "/repo/src/math.cpp:12:9: note: suggested alternative: 'tot'\n"
+        "src/math.cpp:14:5: error: 'class Acc' has no member named 'sum'\n"
+        "math.cpp:20:11: error: no viable conversion from 'std::string' to 'int'\n"
+        "ld: error: undefined symbol: main\n");
+
+    ASSERT_EQ(diagnostics.size(), 3u);
+    EXPECT_EQ(diagnostics[0].file, "/repo/src/math.cpp");
+    EXPECT_EQ(diagnostics[0].line, 12);
+    EXPECT_EQ(diagnostics[0].column, 9);
+    EXPECT_EQ(diagnostics[0].kind, apr_system::DiagnosticKind::Undeclared);
+    EXPECT_EQ(diagnostics[0].name, "total");
+    EXPECT_EQ(diagnostics[1].name, "sum");
+    EXPECT_EQ(diagnostics[2].kind, apr_system::DiagnosticKind::TypeMismatch);
+}
+
+TEST(Validator, CompileFailuresEvictTheirFamily) {
+    apr_system::CompileFailureIndex index;
+    auto failed = makePatch("p0", "Replacement", 12, "total + 1");
+    auto diagnostics = apr_system::parseCompilerDiagnostics(
+        "src/math.cpp:12:9: error: use of undeclared identifier 'total'\n");
+    ASSERT_TRUE(index.record(failed, diagnostics));
+
+    EXPECT_TRUE(index.covers(makePatch("p1", "Insertion", 12, "total;")));
+    EXPECT_FALSE(index.covers(makePatch("p2", "Replacement", 12, "subtotal")));
+    EXPECT_FALSE(index.covers(makePatch("p3", "Replacement", 30, "total")));
+
+    // errors outside the patched lines say nothing about the candidate
+    auto elsewhere = makePatch("p4", "Replacement", 40, "x");
+    EXPECT_FALSE(index.record(elsewhere, diagnostics));
+    EXPECT_FALSE(index.covers(makePatch("p5", "Replacement", 40, "x")));
+
+    auto mismatch = makePatch("p6", "Replacement", 20, "name");
+    ASSERT_TRUE(index.record(mismatch, apr_system::parseCompilerDiagnostics(
+        "src/math.cpp:20:11: error: no viable conversion from 'std::string' to 'int'\n")));
+    EXPECT_TRUE(index.covers(makePatch("p7", "Replacement", 20, " name ")));
+    EXPECT_FALSE(index.covers(makePatch("p8", "Insertion", 20, "name")));
+}
+
+TEST(Validator, WorkspaceClonesARepository) {
+    namespace fs = std::filesystem;
+    const auto repo = fs::temp_directory_path() / "apr_workspace_repo";
+    const auto root = fs::temp_directory_path() / "apr_workspace_clone";
+    fs::remove_all(repo);
+    fs::remove_all(root);
+    fs::create_directories(repo / "src");
+    fs::create_directories(repo / ".git" / "objects" / "ab");
+    std::ofstream(repo / "src" / "a.cpp") << "int a;\n";
+    std::ofstream(repo / ".git" / "objects" / "ab" / "cdef") << "blob";
+    fs::create_symlink("src/a.cpp", repo / "link.cpp");
+    const auto old_time = fs::last_write_time(repo / "src" / "a.cpp") - std::chrono::hours(24);
+    fs::last_write_time(repo / "src" / "a.cpp", old_time);
+
+    auto workspace = apr_system::Workspace::clone(repo, root);
+    EXPECT_EQ(readFile(root / "src" / "a.cpp"), "int a;\n");
+    EXPECT_EQ(fs::last_write_time(root / "src" / "a.cpp"), old_time);
+    EXPECT_TRUE(fs::is_symlink(root / "link.cpp"));
+    // immutable git objects are shared, everything else is private
+    EXPECT_TRUE(fs::equivalent(root / ".git" / "objects" / "ab" / "cdef", repo / ".git" / "objects" / "ab" / "cdef"));
+    EXPECT_FALSE(fs::equivalent(root / "src" / "a.cpp", repo / "src" / "a.cpp"));
+    EXPECT_EQ(workspace->hardlinked(), 1u);
+    EXPECT_EQ(workspace->reflinked() + workspace->copied(), 1u);
+    EXPECT_EQ(workspace->relative(fs::canonical(repo) / "src" / "a.cpp"), fs::path("src/a.cpp"));
+    EXPECT_EQ(workspace->relative("src/a.cpp"), fs::path("src/a.cpp"));
+
+    std::ofstream(root / "src" / "a.cpp") << "int b;\n";
+    EXPECT_EQ(readFile(repo / "src" / "a.cpp"), "int a;\n");
+
+    workspace.reset();
+    EXPECT_FALSE(fs::exists(root));
+    EXPECT_THROW(apr_system::Workspace::clone(repo / "missing", root), std::runtime_error);
+    fs::remove_all(repo);
+}
+
+TEST(Validator, WorkspaceMountNamespaceShowsTheCloneAtTheSourcePath) {
+    namespace fs = std::filesystem;
+    if (!apr_system::Workspace::mountNamespacesAvailable()) {
+        GTEST_SKIP() << "no user or mount namespaces in this environment";
+    }
+    const auto repo = fs::temp_directory_path() / "apr_namespace_repo";
+    const auto root = fs::temp_directory_path() / "apr_namespace_clone";
+    fs::remove_all(repo);
+    fs::remove_all(root);
+    fs::create_directories(repo / "build");
+    // what a cmake build tree looks like: absolute paths into the source tree
+    std::ofstream(repo / "build" / "paths") << (fs::canonical(repo) / "main.cpp").string();
+    std::ofstream(repo / "main.cpp") << "original";
+
+    auto workspace = apr_system::Workspace::clone(repo, root);
+    std::ofstream(root / "main.cpp") << "patched";
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        if (!workspace->enterMountNamespace()) _exit(2);
+        _exit(readFile(readFile(repo / "build" / "paths")) == "patched" ? 0 : 1);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    // the parent's view is untouched
+    EXPECT_EQ(readFile(repo / "main.cpp"), "original");
+
+    workspace.reset();
+    fs::remove_all(repo);
+}
+
+TEST(Validator, WorkersValidateInPrivateClonesAndStopAtTheFirstFix) {
+    namespace fs = std::filesystem;
+    const auto repo = fs::temp_directory_path() / "apr_workers_repo";
+    fs::remove_all(repo);
+    fs::create_directories(repo / "src");
+    std::ofstream(repo / "src" / "math.cpp") << "int add(int a, int b) { return a - b; }\n";
+    writeFakeGTest(repo);
+
+    std::vector<apr_system::PatchCandidate> candidates;
+    std::vector<apr_system::RankedPatch> ranking;
+    for (const char *code : {"a * b", "b - a", "a / b", "a + b", "a % b", "b * a"}) {
+        auto patch = makePatch("patch_" + std::to_string(candidates.size()), "Replacement", 1, code);
+        patch.file_path = (repo / "src" / "math.cpp").string();
+        patch.original_code = "a - b";
+        patch.affected_tests = {"Math.Add"};
+        ranking.push_back({candidates.size(), 1.0});
+        candidates.push_back(std::move(patch));
+    }
+    apr_system::AdaptiveValidationQueue queue(candidates, ranking, 0.0);
+
+    // the workers clone next to the repository, on its filesystem
+    const auto clones = fs::absolute(repo).parent_path() / (".apr_workers_repo.apr-validate-" + std::to_string(::getpid()));
+    const auto seen = fs::temp_directory_path() / "apr_workers_clones_seen";
+    fs::remove(seen);
+    apr_system::RepositoryMetadata metadata;
+    metadata.build_script = "test -d " + clones.string() + " && touch " + seen.string();
+    metadata.test_script = "sh " + (repo / "test.sh").string();
+    apr_system::Validator validator(apr_system::ValidationConfig(5, 100, true, 3));
+    auto results = validator.validatePatches(candidates, queue, metadata, 20);
+
+    ASSERT_FALSE(results.empty());
+    EXPECT_LE(results.size(), candidates.size());
+    EXPECT_EQ(std::count_if(results.begin(), results.end(), [](const auto &r) { return r.tests_passed; }), 1);
+    const auto &fix = *std::find_if(results.begin(), results.end(), [](const auto &r) { return r.tests_passed; });
+    EXPECT_EQ(fix.patch_id, "patch_3");
+    // the fix is applied to the original repository, its artifacts kept next to it
+    EXPECT_EQ(readFile(repo / "src" / "math.cpp"), "int add(int a, int b) { return a + b; }\n");
+    EXPECT_EQ(fs::path(fix.phase_b_artifact_path).parent_path(), fs::absolute(repo / "artifacts" / "gtest"));
+    EXPECT_TRUE(fs::exists(fix.phase_b_artifact_path));
+    EXPECT_TRUE(fs::exists(seen));
+    EXPECT_FALSE(fs::exists(clones));
+    fs::remove(seen);
+    fs::remove_all(repo);
+}
+
+TEST(Validator, WorkersFallBackToInPlaceValidationWithoutWorkspaceMounts) {
+    namespace fs = std::filesystem;
+    const auto repo = fs::temp_directory_path() / "apr_unmounted_workers_repo";
+    fs::remove_all(repo);
+    fs::create_directories(repo / "src");
+    std::ofstream(repo / "src" / "math.cpp") << "int add(int a, int b) { return a - b; }\n";
+    writeFakeGTest(repo);
+
+    std::vector<apr_system::PatchCandidate> candidates;
+    std::vector<apr_system::RankedPatch> ranking;
+    for (const char *code : {"a * b", "b - a", "a + b", "a % b"}) {
+        auto patch = makePatch("patch_" + std::to_string(candidates.size()), "Replacement", 1, code);
+        patch.file_path = (repo / "src" / "math.cpp").string();
+        patch.original_code = "a - b";
+        patch.affected_tests = {"Math.Add"};
+        ranking.push_back({candidates.size(), 1.0});
+        candidates.push_back(std::move(patch));
+    }
+    apr_system::AdaptiveValidationQueue queue(candidates, ranking, 0.0);
+
+    apr_system::RepositoryMetadata metadata;
+    metadata.build_script = "echo build >> builds.log";
+    metadata.test_script = "sh " + (repo / "test.sh").string();
+    apr_system::ValidationConfig config(5, 100, true, 3);
+    config.mount_workspaces = false;
+    apr_system::Validator validator(config);
+    auto results = validator.validatePatches(candidates, queue, metadata, 20);
+
+    // a plain clone would build the original tree, so the candidates are validated one by one in place
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(results[0].patch_id, "patch_0");
+    EXPECT_EQ(results[1].patch_id, "patch_1");
+    EXPECT_EQ(results[2].patch_id, "patch_2");
+    EXPECT_TRUE(results[2].tests_passed);
+    EXPECT_EQ(readFile(repo / "builds.log"), "build\nbuild\nbuild\n");
+    EXPECT_EQ(readFile(repo / "src" / "math.cpp"), "int add(int a, int b) { return a + b; }\n");
+    fs::remove_all(repo);
+}
+
+TEST(Validator, WorkersFallBackToInPlaceValidationWhenTheRepositoryCannotBeCloned) {
+    namespace fs = std::filesystem;
+    const auto repo = fs::temp_directory_path() / "apr_uncloneable_repo";
+    // a file where the workspace directory should be, unwritable even for root
+    const auto blocked = fs::temp_directory_path() / "apr_blocked_workspaces";
+    fs::remove_all(repo);
+    fs::remove_all(blocked);
+    fs::create_directories(repo / "src");
+    std::ofstream(repo / "src" / "math.cpp") << "int add(int a, int b) { return a - b; }\n";
+    std::ofstream(blocked) << "not a directory";
+    writeFakeGTest(repo);
+
+    std::vector<apr_system::PatchCandidate> candidates;
+    std::vector<apr_system::RankedPatch> ranking;
+    for (const char *code : {"a * b", "b - a", "a + b", "a % b"}) {
+        auto patch = makePatch("patch_" + std::to_string(candidates.size()), "Replacement", 1, code);
+        patch.file_path = (repo / "src" / "math.cpp").string();
+        patch.original_code = "a - b";
+        patch.affected_tests = {"Math.Add"};
+        ranking.push_back({candidates.size(), 1.0});
+        candidates.push_back(std::move(patch));
+    }
+    apr_system::AdaptiveValidationQueue queue(candidates, ranking, 0.0);
+
+    apr_system::RepositoryMetadata metadata;
+    metadata.test_script = "sh " + (repo / "test.sh").string();
+    apr_system::ValidationConfig config(5, 100, true, 3);
+    config.workspace_dir = blocked.string();
+    apr_system::Validator validator(config);
+    auto results = validator.validatePatches(candidates, queue, metadata, 20);
+
+    // the candidate taken for the failed clone is validated too, in place
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(results[0].patch_id, "patch_0");
+    EXPECT_EQ(results[1].patch_id, "patch_1");
+    EXPECT_EQ(results[2].patch_id, "patch_2");
+    EXPECT_TRUE(results[2].tests_passed);
+    EXPECT_EQ(readFile(repo / "src" / "math.cpp"), "int add(int a, int b) { return a + b; }\n");
+    fs::remove_all(repo);
+    fs::remove(blocked);
+}
+
+TEST(Validator, PhaseBReusesTheBuildAndRunsOnlyTheRemainingTests) {
+    namespace fs = std::filesystem;
+    const auto repo = fs::temp_directory_path() / "apr_single_build_repo";
+    fs::remove_all(repo);
+    fs::create_directories(repo / "src");
+    std::ofstream(repo / "src" / "math.cpp") << "int add(int a, int b) { return a - b; }\n";
+    writeFakeGTest(repo);
+
+    std::vector<apr_system::PatchCandidate> candidates = {makePatch("patch_0", "Replacement", 1, "a + b")};
+    candidates[0].file_path = (repo / "src" / "math.cpp").string();
+    candidates[0].original_code = "a - b";
+    candidates[0].affected_tests = {"Math.Add"};
+    apr_system::AdaptiveValidationQueue queue(candidates, {{0, 1.0}}, 0.0);
+
+    apr_system::RepositoryMetadata metadata;
+    metadata.build_script = "echo build >> builds.log";
+    metadata.test_script = "sh " + (repo / "test.sh").string();
+    apr_system::Validator validator;
+    auto results = validator.validatePatches(candidates, queue, metadata, 1);
+
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_TRUE(results[0].tests_passed);
+    EXPECT_EQ(readFile(repo / "builds.log"), "build\n");
+    EXPECT_EQ(readFile(repo / "filters.log"), "--gtest_filter=Math.Add\n--gtest_filter=-Math.Add\n");
+    EXPECT_EQ(readFile(repo / "src" / "math.cpp"), "int add(int a, int b) { return a + b; }\n");
+    fs::remove_all(repo);
+}